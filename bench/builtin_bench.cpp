@@ -0,0 +1,90 @@
+// Runs programs written against hand-written helpers and against the builtins (see builtins.hpp) that replace them,
+// and reports the time of each.
+#include <chrono>
+#include <iostream>
+
+#include "bounds.hpp"
+#include "lexer.hpp"
+#include "linker.hpp"
+#include "optimizer.hpp"
+#include "parser.hpp"
+#include "scopes.hpp"
+
+const char *helpers = R"(
+int n = 300000;
+int a[300000];
+int tmp[300000];
+int mx(int x, int y) { if (x > y) { return x; } return y; }
+int mn(int x, int y) { if (x < y) { return x; } return y; }
+int ab(int x) { if (x < 0) { return -x; } return x; }
+int msort(int lo, int hi) {
+  if (hi - lo < 2) { return 0; }
+  int mid = (lo + hi) / 2;
+  msort(lo, mid);
+  msort(mid, hi);
+  int i = lo;
+  int j = mid;
+  for (int k = lo; k < hi; k = k + 1) {
+    int left = j >= hi;
+    if (!left && i < mid) { left = a[i] <= a[j]; }
+    if (left) { tmp[k] = a[i]; i = i + 1; } else { tmp[k] = a[j]; j = j + 1; }
+  }
+  for (int k = lo; k < hi; k = k + 1) { a[k] = tmp[k]; }
+  return 0;
+}
+int main() {
+  int s = 0;
+  for (int i = 0; i < n; i = i + 1) {
+    a[i] = (i * 7919) % 100003 - 50000;
+    s = s + mx(a[i], 0) - mn(a[i], 0) + ab(a[i] % 100);
+  }
+  msort(0, n);
+  return s + a[0];
+}
+main();
+)";
+
+const char *builtins = R"(
+int n = 300000;
+int a[300000];
+int main() {
+  int s = 0;
+  for (int i = 0; i < n; i = i + 1) {
+    a[i] = (i * 7919) % 100003 - 50000;
+    s = s + max(a[i], 0) - min(a[i], 0) + abs(a[i] % 100);
+  }
+  sort(a, a + n);
+  return s + a[0];
+}
+main();
+)";
+
+double bench(const char *program) {
+  double best = 1e100;
+  for (int i = 0; i < 3; ++i) {
+    std::string code = program;
+    Lexer lexer(code);
+    Parser parser(lexer);
+    auto root = parser.parse();
+    Linker().run(*root);
+    OptOptions opts;
+    opts.parallel = false;
+    Optimizer(opts).run(*root);
+    BoundsAnalyzer().run(*root);
+    ScopeAnalyzer().run(*root);
+    Interpreter<> interpreter;
+    auto st_time = std::chrono::steady_clock::now();
+    interpreter.vi_stmt(*root);
+    auto ed_time = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::milli>(ed_time - st_time).count());
+  }
+  return best;
+}
+
+int main() {
+  auto base = bench(helpers);
+  std::cout << "hand-written helpers: " << base << " ms\n";
+  auto res = bench(builtins);
+  std::cout << "builtins: " << res << " ms, speedup " << base / res << "\n";
+  return 0;
+}
@@ -0,0 +1,106 @@
+// Runs a long job and N tiny ones (default 2000, or the first argument) on one thread under a Scheduler, and reports
+// when the tiny jobs were done, against running the same jobs one after the other. Then runs N jobs that each take
+// a few slices, so that all of them are under way at once, and reports the memory that took.
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+
+#include <sys/resource.h>
+
+#include "interpreter.hpp"
+#include "linker.hpp"
+#include "scopes.hpp"
+
+// `n` iterations
+std::string tiny(int n) {
+  return "int n = " + std::to_string(n) + ";\n" + R"(
+int sq(int x) {
+  return x * x;
+}
+int main() {
+  int s = 0;
+  for (int i = 0; i < n; i = i + 1) {
+    s = s + sq(i % 7);
+  }
+  cout << s << endl;
+  return 0;
+}
+main();
+)";
+}
+
+const char *hog = R"(
+int main() {
+  int s = 0;
+  for (int i = 0; i < 5000000; i = i + 1) {
+    s = (s + i) % 1000007;
+  }
+  cout << s << endl;
+  return 0;
+}
+main();
+)";
+
+typedef std::chrono::steady_clock Clock;
+
+void job(std::string code) {
+  Lexer lexer(code);
+  auto root = Parser(lexer).parse();
+  Linker().run(*root);
+  ScopeAnalyzer().run(*root);
+  std::istringstream in;
+  std::ostringstream out;
+  Interpreter<GreenPolicy> interpreter;
+  interpreter.set_streams(in, out);
+  interpreter.vi_stmt(*root);
+}
+
+// milliseconds from `start` to the median and to the last of `done`
+void report(const char *name, Clock::time_point start, std::vector<Clock::time_point> &done) {
+  std::stable_sort(done.begin(), done.end());
+  auto ms = [start](Clock::time_point t) { return std::chrono::duration<double, std::milli>(t - start).count(); };
+  std::cout << name << ": tiny jobs done after " << ms(done[done.size() / 2]) << " ms (median), "
+            << ms(done.back()) << " ms (last)\n";
+}
+
+long peak_kib() {
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+int main(int argc, char **argv) {
+  auto n = argc > 1 ? std::stoul(argv[1]) : 2000;
+  std::vector<Clock::time_point> done;
+
+  auto start = Clock::now();
+  job(hog);
+  for (std::size_t i = 0; i < n; ++i) {
+    job(tiny(1000));
+    done.push_back(Clock::now());
+  }
+  report("one after the other", start, done);
+
+  done.clear();
+  Scheduler scheduler(std::size_t(256) << 10, std::chrono::milliseconds(1));
+  scheduler.add([] { job(hog); });
+  for (std::size_t i = 0; i < n; ++i) {
+    scheduler.add([&done] {
+      job(tiny(1000));
+      done.push_back(Clock::now());
+    });
+  }
+  start = Clock::now();
+  scheduler.run();
+  report("scheduled", start, done);
+
+  auto before = peak_kib();
+  Scheduler all(std::size_t(256) << 10, std::chrono::milliseconds(1));
+  for (std::size_t i = 0; i < n; ++i) {
+    all.add([] { job(tiny(10000)); });
+  }
+  all.run();
+  std::cout << n << " jobs under way at once: peak memory up by " << (peak_kib() - before) / 1024 << " MiB\n";
+  return 0;
+}
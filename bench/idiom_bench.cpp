@@ -0,0 +1,58 @@
+// Runs array loops that IdiomRecognizer maps to native kernels (fill, copy, sum, max, prefix sums), once with the
+// kernels and once interpreted.
+#include <chrono>
+#include <iostream>
+
+#include "bounds.hpp"
+#include "lexer.hpp"
+#include "linker.hpp"
+#include "optimizer.hpp"
+#include "parser.hpp"
+#include "scopes.hpp"
+
+const char *program = R"(
+int n = 100000;
+int a[100000];
+int b[100000];
+int s = 0;
+int m = 0;
+int main() {
+  for (int r = 0; r < 10; r = r + 1) {
+    for (int i = 0; i < n; i = i + 1) a[i] = r;
+    for (int i = 0; i < n; i = i + 1) b[i] = a[i];
+    for (int i = 1; i < n; i = i + 1) b[i] = b[i - 1] + a[i];
+    for (int i = 0; i < n; i = i + 1) s = s + b[i];
+    for (int i = 0; i < n; i = i + 1) { if (b[i] > m) { m = b[i]; } }
+  }
+  return s + m;
+}
+main();
+)";
+
+void bench(const char *name, bool idioms, int rounds) {
+  double best = 1e100;
+  for (int i = 0; i < rounds; ++i) {
+    std::string code = program;
+    Lexer lexer(code);
+    Parser parser(lexer);
+    auto root = parser.parse();
+    Linker().run(*root);
+    OptOptions opts;
+    opts.idioms = idioms;
+    Optimizer(opts).run(*root);
+    BoundsAnalyzer().run(*root);
+    ScopeAnalyzer().run(*root);
+    Interpreter<> interpreter;
+    auto st_time = std::chrono::steady_clock::now();
+    interpreter.vi_stmt(*root);
+    auto ed_time = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::milli>(ed_time - st_time).count());
+  }
+  std::cout << name << ": best of " << rounds << ": " << best << " ms\n";
+}
+
+int main() {
+  bench("interpreted", false, 3);
+  bench("native kernels", true, 3);
+  return 0;
+}
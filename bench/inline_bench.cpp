@@ -0,0 +1,64 @@
+// Runs loops calling small helpers with and without inlining them (see Inliner) and reports the time of each.
+#include <chrono>
+#include <iostream>
+
+#include "bounds.hpp"
+#include "lexer.hpp"
+#include "linker.hpp"
+#include "optimizer.hpp"
+#include "parser.hpp"
+#include "scopes.hpp"
+
+const char *program = R"(
+int M = 1000;
+int g[1000000];
+int sq(int x) { return x * x; }
+int idx(int i, int j) { return i * M + j; }
+int dist(int a, int b, int c, int d) { return sq(a - c) + sq(b - d); }
+int main() {
+  int s = 0;
+  for (int i = 0; i < M; i = i + 1) {
+    for (int j = 0; j < M; j = j + 1) {
+      g[idx(i, j)] = dist(i, j, 500, 500) % 7;
+    }
+  }
+  for (int i = 1; i < M; i = i + 1) {
+    for (int j = 0; j < M; j = j + 1) {
+      s = s + g[idx(i, j)] - g[idx(i - 1, j)];
+    }
+  }
+  return s;
+}
+main();
+)";
+
+double bench(bool inline_calls) {
+  double best = 1e100;
+  for (int i = 0; i < 3; ++i) {
+    std::string code = program;
+    Lexer lexer(code);
+    Parser parser(lexer);
+    auto root = parser.parse();
+    Linker().run(*root);
+    OptOptions opts;
+    opts.inline_calls = inline_calls;
+    opts.parallel = false;
+    Optimizer(opts).run(*root);
+    BoundsAnalyzer().run(*root);
+    ScopeAnalyzer().run(*root);
+    Interpreter<> interpreter;
+    auto st_time = std::chrono::steady_clock::now();
+    interpreter.vi_stmt(*root);
+    auto ed_time = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::milli>(ed_time - st_time).count());
+  }
+  return best;
+}
+
+int main() {
+  auto calls = bench(false);
+  std::cout << "calls: " << calls << " ms\n";
+  auto inlined = bench(true);
+  std::cout << "inlined: " << inlined << " ms, speedup " << calls / inlined << "\n";
+  return 0;
+}
@@ -0,0 +1,60 @@
+// Parses a generated source of many functions, of which main calls three, with every body parsed up front and with
+// the bodies left for their first call (see LazySource), and reports the time to the first instruction, the time of
+// the whole run and the nodes of the tree after it. The size in MiB may be given as the first argument.
+#include <chrono>
+#include <iostream>
+
+#include "interpreter.hpp"
+
+std::string source(std::size_t bytes) {
+  std::string res;
+  for (int i = 0; res.size() < bytes; ++i) {
+    auto k = std::to_string(i);
+    res += "int f" + k + "(int x) {\n  int s = 0;\n  for (int i = 0; i < x; i = i + 1) {\n" +
+           "    if (i % 3 == 0) {\n      s = s + i * " + k + ";\n    } else {\n      s = s - x;\n    }\n  }\n" +
+           "  return s;\n}\n";
+  }
+  return res + "int main() {\n  return f0(10) + f1(20) + f2(30);\n}\nmain();";
+}
+
+std::size_t nodes(Node &root) {
+  std::size_t res = 0;
+  walk(root, [&res](Node &node) {
+    res++;
+    if (auto fn = dynamic_cast<FnDeclNode *>(&node); fn != nullptr && fn->block != nullptr) {
+      res += nodes(*fn->block);
+    }
+    return node.kind != NodeKind::FN_DECL;
+  });
+  return res;
+}
+
+void bench(const std::string &code, bool lazy) {
+  auto st_time = std::chrono::steady_clock::now();
+  std::shared_ptr<ScopeNode> root;
+  if (lazy) {
+    root = std::make_shared<LazySource>(code)->parse();
+  } else {
+    auto copy = code;
+    Lexer lexer(copy);
+    root = Parser(lexer).parse();
+  }
+  Linker().run(*root);
+  ScopeAnalyzer().run(*root);
+  auto ready = std::chrono::steady_clock::now();
+  Interpreter<> interpreter;
+  interpreter.vi_stmt(*root);
+  auto ed_time = std::chrono::steady_clock::now();
+  auto ms = [](auto d) { return std::chrono::duration<double, std::milli>(d).count(); };
+  std::cout << (lazy ? "lazy bodies" : "parsed bodies") << ": first instruction after " << ms(ready - st_time)
+            << " ms, run " << ms(ed_time - st_time) << " ms, " << nodes(*root) << " nodes\n";
+}
+
+int main(int argc, char **argv) {
+  auto mib = argc > 1 ? std::stoul(argv[1]) : 8;
+  auto code = source(mib << 20);
+  std::cout << "source: " << code.size() / 1048576 << " MiB\n";
+  bench(code, false);
+  bench(code, true);
+  return 0;
+}
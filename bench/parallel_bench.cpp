@@ -0,0 +1,92 @@
+// Runs a loop with independent iterations and a divide and conquer recursion (see ParallelAnalyzer) on 1, 2, 4, ...
+// threads up to one per core and reports the speedup over one thread. An argument overrides the core count.
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include "bounds.hpp"
+#include "lexer.hpp"
+#include "linker.hpp"
+#include "optimizer.hpp"
+#include "parser.hpp"
+#include "scopes.hpp"
+
+const char *loop = R"(
+int n = 1000;
+int a[1000];
+int steps(int v) {
+  int s = 0;
+  while (v != 1) {
+    if (v % 2 == 0) { v = v / 2; } else { v = 3 * v + 1; }
+    s = s + 1;
+  }
+  return s;
+}
+int main() {
+  for (int i = 0; i < n; i = i + 1) {
+    int best = 0;
+    for (int j = 1; j <= 10; j = j + 1) {
+      int s = steps(i * 10 + j);
+      if (s > best) { best = s; }
+    }
+    a[i] = best;
+  }
+  return a[n - 1];
+}
+main();
+)";
+
+const char *recursion = R"(
+int fib(int k) {
+  if (k < 2) { return k; }
+  return fib(k - 1) + fib(k - 2);
+}
+int main() {
+  return fib(24);
+}
+main();
+)";
+
+double bench(const char *program, std::size_t threads, int rounds) {
+  double best = 1e100;
+  for (int i = 0; i < rounds; ++i) {
+    std::string code = program;
+    Lexer lexer(code);
+    Parser parser(lexer);
+    auto root = parser.parse();
+    Linker().run(*root);
+    // folding would evaluate the recursion ahead of time
+    OptOptions opts;
+    opts.fold = false;
+    Optimizer(opts).run(*root);
+    BoundsAnalyzer().run(*root);
+    ScopeAnalyzer().run(*root);
+    WorkPool pool(threads - 1);
+    Interpreter<> interpreter;
+    if (threads > 1) {
+      interpreter.set_pool(&pool);
+    }
+    auto st_time = std::chrono::steady_clock::now();
+    interpreter.vi_stmt(*root);
+    auto ed_time = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::milli>(ed_time - st_time).count());
+  }
+  return best;
+}
+
+void bench(const char *name, const char *program, std::size_t cores) {
+  auto base = bench(program, 1, 3);
+  std::cout << name << ", 1 thread: " << base << " ms\n";
+  for (std::size_t threads = 2; threads <= cores; threads *= 2) {
+    auto res = bench(program, threads, 3);
+    std::cout << name << ", " << threads << " threads: " << res << " ms, speedup " << base / res << " ("
+              << base / res / static_cast<double>(threads) << " per core)\n";
+  }
+}
+
+int main(int argc, char **argv) {
+  std::size_t cores = argc > 1 ? std::stoul(argv[1]) : std::max(1u, std::thread::hardware_concurrency());
+  bench("loop", loop, cores);
+  bench("recursion", recursion, cores);
+  return 0;
+}
@@ -0,0 +1,87 @@
+// Parses a generated source of many functions with Parser and with ParallelParser on pools of 1 to 8 threads,
+// checks that the trees match, and reports the time of each. The size in MiB may be given as the first argument.
+#include <chrono>
+#include <iostream>
+#include <sstream>
+
+#include "parallel_parser.hpp"
+
+std::string source(std::size_t bytes) {
+  std::string res = "int a[1000];\n";
+  for (int i = 0; res.size() < bytes; ++i) {
+    auto k = std::to_string(i);
+    res += "int f" + k + "(int x, int v[]) {\n  int s = 0;\n  for (int i = 0; i < x; i = i + 1) {\n" +
+           "    if (i % 3 == 0) {\n      s = s + v[i % 1000] * " + k + ";\n    } else {\n      a[(i + " + k +
+           ") % 1000] = s - x;\n    }\n  }\n  return s" + (i > 0 ? " + f" + std::to_string(i - 1) + "(x - 1, v)" : "") +
+           ";\n}\n";
+  }
+  return res + "int main() {\n  return 0;\n}\nmain();";
+}
+
+// kind, names, values and locations of every node, in pre-order
+void fingerprint(Node &root, std::ostream &os) {
+  walk(root, [&os](Node &node) {
+    os << static_cast<int>(node.kind) << ' ';
+    if (auto var = dynamic_cast<VarNode *>(&node)) {
+      os << var->var_name << ' ';
+    } else if (auto decl = dynamic_cast<VarDeclNode *>(&node)) {
+      os << decl->var->var_name << decl->var_type << ' ';
+    } else if (auto fn = dynamic_cast<FnDeclNode *>(&node)) {
+      os << fn->name << '(';
+      for (auto &param : fn->params) {
+        os << param->var->var_name << '/' << param->dimensions.size() << ' ';
+      }
+      os << ") ";
+    } else if (auto call = dynamic_cast<FnCallNode *>(&node)) {
+      os << call->name << ' ';
+    } else if (auto arr = dynamic_cast<ArrDeclNode *>(&node)) {
+      os << arr->name << arr->type << ' ';
+    } else if (auto acc = dynamic_cast<ArrAccessNode *>(&node)) {
+      os << acc->name << '@' << acc->loc.line << ':' << acc->loc.col << ' ';
+    } else if (auto num = dynamic_cast<NumNode *>(&node)) {
+      os << num->value << ' ';
+    } else if (auto bin = dynamic_cast<BinNode *>(&node)) {
+      os << static_cast<int>(bin->op) << ' ';
+    }
+    std::size_t children = 0;
+    for_each_child(node, [&children](auto &) { children++; });
+    os << children << '\n';
+    return true;
+  });
+}
+
+template <typename F>
+double time_ms(F &&f) {
+  auto st_time = std::chrono::steady_clock::now();
+  f();
+  auto ed_time = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(ed_time - st_time).count();
+}
+
+int main(int argc, char **argv) {
+  auto mib = argc > 1 ? std::stoul(argv[1]) : 8;
+  auto code = source(mib << 20);
+  std::cout << "source: " << code.size() / 1048576 << " MiB\n";
+  std::shared_ptr<ScopeNode> expected;
+  auto base = time_ms([&] {
+    auto copy = code;
+    Lexer lexer(copy);
+    expected = Parser(lexer).parse();
+  });
+  std::cout << "Parser: " << base << " ms\n";
+  std::ostringstream want;
+  fingerprint(*expected, want);
+  for (std::size_t threads = 1; threads <= 8; threads *= 2) {
+    WorkPool pool(threads - 1);
+    std::shared_ptr<ScopeNode> root;
+    auto ms = time_ms([&] {
+      auto copy = code;
+      root = ParallelParser(&pool).parse(copy);
+    });
+    std::ostringstream got;
+    fingerprint(*root, got);
+    std::cout << "ParallelParser, " << threads << " threads: " << ms << " ms, speedup " << base / ms
+              << (got.str() == want.str() ? ", same tree\n" : ", DIFFERENT TREE\n");
+  }
+  return 0;
+}
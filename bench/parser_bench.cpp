@@ -0,0 +1,75 @@
+// Lexes and parses synthetic expression-heavy sources: long arithmetic/logical expressions and large literal
+// tables written as one assignment per element, as machine-generated submissions do.
+#include <chrono>
+#include <iostream>
+#include <random>
+
+#include "parser.hpp"
+
+std::string gen_expr(std::mt19937 &rng, int depth) {
+  static const char *ops[] = {"+", "-", "*", "/", "%", "==", "!=", "<", "<=", ">", ">=", "^", "&&", "||"};
+  if (depth == 0 || rng() % 5 == 0) {
+    switch (rng() % 3) {
+      case 0:
+        return std::to_string(rng() % 1000);
+      case 1:
+        return std::string(1, static_cast<char>('a' + rng() % 26));
+      default:
+        return "t[" + std::to_string(rng() % 1000) + "]";
+    }
+  }
+  std::string res;
+  if (rng() % 8 == 0) {
+    res += '(';
+    res += gen_expr(rng, depth - 1);
+    res += ')';
+    return res;
+  }
+  res += gen_expr(rng, depth - 1);
+  res += ' ';
+  res += ops[rng() % 14];
+  res += ' ';
+  res += gen_expr(rng, depth - 1);
+  return res;
+}
+
+std::string gen_exprs(std::size_t lines) {
+  std::mt19937 rng(42);
+  std::string res;
+  for (std::size_t i = 0; i < lines; ++i) {
+    res += "x = " + gen_expr(rng, 7) + ";\n";
+  }
+  return res;
+}
+
+std::string gen_table(std::size_t entries) {
+  std::mt19937 rng(42);
+  std::string res = "int t[" + std::to_string(entries) + "];\n";
+  for (std::size_t i = 0; i < entries; ++i) {
+    res += "t[" + std::to_string(i) + "] = " + std::to_string(rng() % 1000000) + ";\n";
+  }
+  return res;
+}
+
+void bench(const char *name, const std::string &code, int rounds) {
+  double best = 1e100;
+  std::size_t nodes = 0;
+  for (int i = 0; i < rounds; ++i) {
+    auto copy = code;
+    auto st_time = std::chrono::steady_clock::now();
+    Lexer lexer(copy);
+    Parser parser(lexer);
+    auto program = parser.parse();
+    auto ed_time = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::milli>(ed_time - st_time).count());
+    nodes = program->block->children.size();
+  }
+  std::cout << name << ": " << code.size() / 1024 << " KiB, " << nodes << " statements, best of " << rounds << ": "
+            << best << " ms (" << static_cast<double>(code.size()) / 1048576 / (best / 1000) << " MiB/s)\n";
+}
+
+int main() {
+  bench("expressions", gen_exprs(20000), 5);
+  bench("literal table", gen_table(200000), 5);
+  return 0;
+}
@@ -0,0 +1,81 @@
+// Runs a recursive function declaring local arrays of three element types, and reports the time and the calls to
+// the general-purpose heap per interpreted call, with the blocks the Recycler took from its free lists.
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+#include "bounds.hpp"
+#include "lexer.hpp"
+#include "linker.hpp"
+#include "optimizer.hpp"
+#include "parser.hpp"
+#include "scopes.hpp"
+
+// counts calls of the replaced operator new, which GCC takes for a mismatch with the free() in operator delete
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+std::atomic<std::uint64_t> heap_calls = 0;
+
+void *operator new(std::size_t n) {
+  heap_calls.fetch_add(1, std::memory_order_relaxed);
+  if (auto res = std::malloc(n == 0 ? 1 : n)) {
+    return res;
+  }
+  throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+const char *program = R"(
+int depth = 20;
+int walk(int d) {
+  int buf[100];
+  char name[33];
+  bool seen[70];
+  int grid[4][5];
+  buf[d % 100] = d;
+  name[d % 33] = 97;
+  seen[d % 70] = 1;
+  grid[d % 4][d % 5] = buf[d % 100] + name[d % 33];
+  if (d == 0) {
+    return grid[0][0] + seen[0];
+  }
+  return walk(d - 1) + grid[d % 4][d % 5] + seen[d % 70];
+}
+int main() {
+  int s = 0;
+  for (int i = 0; i < 20000; i = i + 1) {
+    s = s + walk(depth + i % 3);
+  }
+  return s;
+}
+main();
+)";
+
+int main() {
+  std::string code = program;
+  Lexer lexer(code);
+  Parser parser(lexer);
+  auto root = parser.parse();
+  Linker().run(*root);
+  OptOptions opts;
+  opts.parallel = false;
+  Optimizer(opts).run(*root);
+  BoundsAnalyzer().run(*root);
+  ScopeAnalyzer().run(*root);
+  Interpreter<> interpreter;
+  auto before = heap_calls.load();
+  auto st_time = std::chrono::steady_clock::now();
+  interpreter.vi_stmt(*root);
+  auto ed_time = std::chrono::steady_clock::now();
+  double calls = 0;
+  for (int i = 0; i < 20000; ++i) {
+    calls += 20 + i % 3 + 1;
+  }
+  auto stats = interpreter.stats();
+  std::cout << "time: " << std::chrono::duration<double, std::milli>(ed_time - st_time).count() << " ms\n"
+            << "heap calls per interpreted call: " << static_cast<double>(heap_calls.load() - before) / calls << "\n"
+            << "blocks from the heap: " << stats.heap_blocks << ", recycled: " << stats.recycled_blocks << "\n";
+  return 0;
+}
@@ -0,0 +1,47 @@
+// Parses a source of a few thousand functions from scratch, then with IncrementalParser after editing one function
+// and after inserting a line at the top, which moves every declaration.
+#include <chrono>
+#include <iostream>
+
+#include "incremental.hpp"
+
+std::string source(int fns, int edited) {
+  std::string res = "int a[100];\n";
+  for (int i = 0; i < fns; ++i) {
+    auto k = std::to_string(i);
+    res += "int f" + k + "(int x) {\n  int s = 0;\n  for (int i = 0; i < x; i = i + 1) {\n" +
+           "    a[i % 100] = a[i % 100] + " + std::to_string(i == edited ? -1 : i) + ";\n    s = s + a[i % 100];\n" +
+           "  }\n  return s" + (i > 0 ? " + f" + std::to_string(i - 1) + "(x - 1)" : "") + ";\n}\n";
+  }
+  return res + "int main() {\n  return f" + std::to_string(fns - 1) + "(10);\n}\nmain();";
+}
+
+template <typename F>
+double time_ms(F &&f) {
+  auto st_time = std::chrono::steady_clock::now();
+  f();
+  auto ed_time = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(ed_time - st_time).count();
+}
+
+int main() {
+  const int fns = 5000;
+  auto code = source(fns, -1), edited = source(fns, fns / 2), moved = "int b;\n" + edited;
+  std::cout << "source: " << code.size() << " bytes, " << fns << " functions\n";
+  std::cout << "full parse: " << time_ms([&] {
+    std::string copy = code;
+    Lexer lexer(copy);
+    Parser parser(lexer);
+    auto root = parser.parse();
+    Linker().run(*root);
+    BoundsAnalyzer().run(*root);
+    ScopeAnalyzer().run(*root);
+  }) << " ms\n";
+  IncrementalParser inc;
+  std::cout << "incremental, first version: " << time_ms([&] { inc.update(code); }) << " ms\n";
+  std::cout << "incremental, one function edited: " << time_ms([&] { inc.update(edited); }) << " ms, parsed "
+            << inc.parsed_count() << '\n';
+  std::cout << "incremental, all functions moved: " << time_ms([&] { inc.update(moved); }) << " ms, parsed "
+            << inc.parsed_count() << '\n';
+  return 0;
+}
@@ -0,0 +1,57 @@
+// Runs a sieve of Eratosthenes over an int, a char and a bool array, the last stored both a byte and a bit per
+// element, and reports the time and peak memory of each.
+#include <chrono>
+#include <iostream>
+
+#include "bounds.hpp"
+#include "lexer.hpp"
+#include "linker.hpp"
+#include "optimizer.hpp"
+#include "parser.hpp"
+#include "scopes.hpp"
+
+std::string sieve(const std::string &type) {
+  return "int n = 2000000;\n" + type + R"( composite[2000001];
+int main() {
+  int primes = 0;
+  for (int i = 2; i <= n; i = i + 1) {
+    if (!composite[i]) {
+      primes = primes + 1;
+      for (int j = i * i; j <= n && i <= 46340; j = j + i) {
+        composite[j] = 1;
+      }
+    }
+  }
+  return primes;
+}
+main();
+)";
+}
+
+void bench(const char *name, const std::string &type, bool packed_bools) {
+  std::string code = sieve(type);
+  Lexer lexer(code);
+  Parser parser(lexer);
+  auto root = parser.parse();
+  Linker().run(*root);
+  Optimizer().run(*root);
+  BoundsAnalyzer().run(*root);
+  ScopeAnalyzer().run(*root);
+  Interpreter<> interpreter;
+  ArrayOptions arrays;
+  arrays.packed_bools = packed_bools;
+  interpreter.set_array_options(arrays);
+  auto st_time = std::chrono::steady_clock::now();
+  interpreter.vi_stmt(*root);
+  auto ed_time = std::chrono::steady_clock::now();
+  std::cout << name << ": " << std::chrono::duration<double, std::milli>(ed_time - st_time).count() << " ms, peak "
+            << interpreter.stats().peak_memory << " bytes\n";
+}
+
+int main() {
+  bench("int", "int", true);
+  bench("char", "char", true);
+  bench("bool, a byte each", "bool", false);
+  bench("bool, a bit each", "bool", true);
+  return 0;
+}
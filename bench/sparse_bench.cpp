@@ -0,0 +1,61 @@
+// Declares a 400 MB int array and touches one element every 4 MB, with the array mapped on demand (small and huge
+// pages) and allocated zeroed from the heap, and reports the time and the peak resident memory of each, in that
+// order, so the peak grows with each run.
+#include <chrono>
+#include <iostream>
+
+#include <sys/resource.h>
+
+#include "bounds.hpp"
+#include "lexer.hpp"
+#include "linker.hpp"
+#include "optimizer.hpp"
+#include "parser.hpp"
+#include "scopes.hpp"
+
+const char *program = R"(
+int a[100000000];
+int main() {
+  int s = 0;
+  for (int i = 0; i < 100000000; i = i + 1000000) {
+    a[i] = i;
+    s = s + a[i];
+  }
+  return s;
+}
+main();
+)";
+
+long peak_rss_kb() {
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+void bench(const char *name, std::size_t map_threshold, bool huge_pages) {
+  std::string code = program;
+  Lexer lexer(code);
+  Parser parser(lexer);
+  auto root = parser.parse();
+  Linker().run(*root);
+  Optimizer().run(*root);
+  BoundsAnalyzer().run(*root);
+  ScopeAnalyzer().run(*root);
+  Interpreter<> interpreter;
+  ArrayOptions arrays;
+  arrays.map_threshold = map_threshold;
+  arrays.huge_pages = huge_pages;
+  interpreter.set_array_options(arrays);
+  auto st_time = std::chrono::steady_clock::now();
+  interpreter.vi_stmt(*root);
+  auto ed_time = std::chrono::steady_clock::now();
+  std::cout << name << ": " << std::chrono::duration<double, std::milli>(ed_time - st_time).count()
+            << " ms, peak RSS " << peak_rss_kb() << " KB\n";
+}
+
+int main() {
+  bench("mapped", 1 << 20, false);
+  bench("mapped, huge pages", 1 << 20, true);
+  bench("heap", SIZE_MAX, false);
+  return 0;
+}
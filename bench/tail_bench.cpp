@@ -0,0 +1,67 @@
+// Runs self- and mutually tail-recursive functions, with their tail calls made in the caller's frame (see
+// TailCallAnalyzer) and without, and reports the time and peak memory of each. Without, the depth is kept to what
+// the host stack takes.
+#include <chrono>
+#include <iostream>
+
+#include "bounds.hpp"
+#include "lexer.hpp"
+#include "linker.hpp"
+#include "optimizer.hpp"
+#include "parser.hpp"
+#include "scopes.hpp"
+
+std::string program(int n) {
+  return "int n = " + std::to_string(n) + ";\n" + R"(
+int count(int k, int acc) {
+  if (k == 0) {
+    return acc;
+  }
+  return count(k - 1, acc + k % 7);
+}
+int even(int k) {
+  if (k == 0) {
+    return 1;
+  }
+  return odd(k - 1);
+}
+int odd(int k) {
+  if (k == 0) {
+    return 0;
+  }
+  return even(k - 1);
+}
+int main() {
+  return count(n, 0) + even(n);
+}
+main();
+)";
+}
+
+void bench(const char *name, int n, bool tail_calls) {
+  std::string code = program(n);
+  Lexer lexer(code);
+  Parser parser(lexer);
+  auto root = parser.parse();
+  Linker().run(*root);
+  OptOptions opts;
+  opts.tail_calls = tail_calls;
+  opts.parallel = false;
+  Optimizer(opts).run(*root);
+  BoundsAnalyzer().run(*root);
+  ScopeAnalyzer().run(*root);
+  Interpreter<GovernedPolicy> interpreter;
+  auto st_time = std::chrono::steady_clock::now();
+  interpreter.vi_stmt(*root);
+  auto ed_time = std::chrono::steady_clock::now();
+  auto ms = std::chrono::duration<double, std::milli>(ed_time - st_time).count();
+  std::cout << name << ", " << n << " calls each: " << ms << " ms (" << ms * 1e6 / (2.0 * n) << " ns per call), peak "
+            << interpreter.stats().peak_memory << " bytes\n";
+}
+
+int main() {
+  bench("frame per call", 10000, false);
+  bench("tail calls", 10000, true);
+  bench("tail calls", 10000000, true);
+  return 0;
+}
@@ -0,0 +1,223 @@
+#ifndef __BOUNDS_HPP
+#define __BOUNDS_HPP
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "walker.hpp"
+
+// Range analysis for counted loops `for (...; iv < bound; iv = iv + k)`. An array access in the body indexed by
+// `iv + c` gets a LoopGuard on the loop; the interpreter checks each guard once at loop entry and skips the
+// per-access bounds check of accesses whose dimensions are all covered by guards that held.
+// Guard bits are the for-loop nesting depth inside the enclosing function. Guarded loops never contain calls, so
+// two loops sharing a bit are never active at the same time.
+class BoundsAnalyzer {
+  protected:
+  static constexpr unsigned max_depth = 64;
+
+  // loop depth guarding each dimension of an access, -1 if unguarded
+  std::unordered_map<ArrAccessNode *, std::vector<int>> coverage;
+
+  public:
+  // loop shape helpers, shared with IdiomRecognizer
+
+  // names written or declared in a subtree; `opaque` if it calls functions, which may write anything
+  struct Writes {
+    std::unordered_set<Symbol> names;
+    bool opaque = false;
+  };
+
+  static void collect_writes(Node &root, Writes &w) {
+    walk(root, [&w](Node &node) {
+      if (auto assign = dynamic_cast<AssignNode *>(&node)) {
+        if (auto lv = dynamic_cast<VarNode *>(assign->l.get())) {
+          w.names.insert(lv->var_name);
+        }
+      } else if (auto io = dynamic_cast<IOInNode *>(&node)) {
+        for (auto &i : io->body) {
+          if (auto lv = dynamic_cast<VarNode *>(i.get())) {
+            w.names.insert(lv->var_name);
+          }
+        }
+      } else if (auto decl = dynamic_cast<VarDeclNode *>(&node)) {
+        w.names.insert(decl->var->var_name);
+      } else if (auto arr_decl = dynamic_cast<ArrDeclNode *>(&node)) {
+        w.names.insert(arr_decl->name);
+      } else if (auto fn_decl = dynamic_cast<FnDeclNode *>(&node)) {
+        w.names.insert(fn_decl->name);
+        return false;
+      } else if (dynamic_cast<FnCallNode *>(&node)) {
+        w.opaque = true;
+      }
+      return true;
+    });
+  }
+
+  static bool is_invariant(Node &node, const Writes &w) {
+    if (dynamic_cast<NumNode *>(&node)) {
+      return true;
+    }
+    if (auto var = dynamic_cast<VarNode *>(&node)) {
+      return !w.names.contains(var->var_name);
+    }
+    if (auto bin = dynamic_cast<BinNode *>(&node)) {
+      return is_invariant(*bin->l, w) && is_invariant(*bin->r, w);
+    }
+    if (auto unary = dynamic_cast<UnaryNode *>(&node)) {
+      return is_invariant(*unary->expr, w);
+    }
+    return false;
+  }
+
+  static bool is_var(const std::shared_ptr<Node> &node, Symbol name) {
+    auto var = dynamic_cast<VarNode *>(node.get());
+    return var != nullptr && var->var_name == name;
+  }
+
+  static bool is_num(const std::shared_ptr<Node> &node, int &value) {
+    auto num = dynamic_cast<NumNode *>(node.get());
+    if (num == nullptr) {
+      return false;
+    }
+    value = num->value;
+    return true;
+  }
+
+  // matches `iv`, `iv + c`, `c + iv` and `iv - c`
+  static bool index_offset(const std::shared_ptr<Node> &idx, Symbol iv, int &off) {
+    if (is_var(idx, iv)) {
+      off = 0;
+      return true;
+    }
+    auto bin = dynamic_cast<BinNode *>(idx.get());
+    if (bin == nullptr) {
+      return false;
+    }
+    if (bin->op == TokenType::PLUS) {
+      return (is_var(bin->l, iv) && is_num(bin->r, off)) || (is_num(bin->l, off) && is_var(bin->r, iv));
+    }
+    if (bin->op == TokenType::MINUS && is_var(bin->l, iv) && is_num(bin->r, off)) {
+      off = -off;
+      return true;
+    }
+    return false;
+  }
+
+  // matches `iv = iv + k`, `iv = k + iv` and `iv = iv - k`
+  static bool loop_step(const std::shared_ptr<Node> &upd, Symbol iv, int &step) {
+    auto assign = dynamic_cast<AssignNode *>(upd.get());
+    if (assign == nullptr || !is_var(assign->l, iv)) {
+      return false;
+    }
+    return index_offset(assign->r, iv, step) && step != 0;
+  }
+
+  protected:
+  void analyze_loop(ForLoopNode &forl, unsigned depth) {
+    auto cond = dynamic_cast<BinNode *>(forl.cond.get());
+    if (depth >= max_depth || cond == nullptr || forl.upd.size() != 1) {
+      return;
+    }
+    auto iv = dynamic_cast<VarNode *>(cond->l.get());
+    int step;
+    if (iv == nullptr || !loop_step(forl.upd[0], iv->var_name, step)) {
+      return;
+    }
+    switch (cond->op) {
+      case TokenType::CMP_LES:
+      case TokenType::CMP_LTE:
+        if (step < 0) {
+          return;
+        }
+        break;
+      case TokenType::CMP_GRT:
+      case TokenType::CMP_GTE:
+        if (step > 0) {
+          return;
+        }
+        break;
+      default:
+        return;
+    }
+
+    Writes w;
+    collect_writes(*forl.body, w);
+    if (w.opaque || w.names.contains(iv->var_name) || cond->r == nullptr) {
+      return;
+    }
+    // the bound must not depend on the induction variable either
+    w.names.insert(iv->var_name);
+    auto invariant = is_invariant(*cond->r, w);
+    w.names.erase(iv->var_name);
+    if (!invariant) {
+      return;
+    }
+
+    walk(*forl.body, [&](Node &node) {
+      if (dynamic_cast<FnDeclNode *>(&node)) {
+        return false;
+      }
+      auto acc = dynamic_cast<ArrAccessNode *>(&node);
+      if (acc == nullptr || w.names.contains(acc->name)) {
+        return true;
+      }
+      auto &cov = coverage.try_emplace(acc, acc->dimensions.size(), -1).first->second;
+      for (std::size_t dim = 0; dim < acc->dimensions.size(); ++dim) {
+        int off;
+        if (cov[dim] != -1 || !index_offset(acc->dimensions[dim], iv->var_name, off)) {
+          continue;
+        }
+        cov[dim] = static_cast<int>(depth);
+        auto guard = std::find_if(forl.guards.begin(), forl.guards.end(),
+                                  [&](const LoopGuard &g) { return g.arr == acc->name && g.dim == dim; });
+        if (guard == forl.guards.end()) {
+          forl.guards.push_back({acc->name, dim, off, off});
+        } else {
+          guard->min_off = std::min(guard->min_off, off);
+          guard->max_off = std::max(guard->max_off, off);
+        }
+      }
+      return true;
+    });
+
+    if (!forl.guards.empty()) {
+      forl.iv = iv->var_name;
+      forl.bound = cond->r;
+      forl.bound_op = cond->op;
+      forl.guard_bit = std::uint64_t(1) << depth;
+    }
+  }
+
+  void visit(Node &node, unsigned depth) {
+    if (auto fn_decl = dynamic_cast<FnDeclNode *>(&node)) {
+      if (fn_decl->block != nullptr) {
+        visit(*fn_decl->block, 0);
+      }
+      return;
+    }
+    if (auto forl = dynamic_cast<ForLoopNode *>(&node)) {
+      for_each_child(node, [&](auto &child) { visit(*child, depth + 1); });
+      analyze_loop(*forl, depth);
+      return;
+    }
+    for_each_child(node, [&](auto &child) { visit(*child, depth); });
+  }
+
+  public:
+  void run(Node &root) {
+    visit(root, 0);
+    for (auto &[acc, cov] : coverage) {
+      std::uint64_t mask = 0;
+      for (auto depth : cov) {
+        if (depth == -1) {
+          mask = 0;
+          break;
+        }
+        mask |= std::uint64_t(1) << depth;
+      }
+      acc->guard_mask = mask;
+    }
+    coverage.clear();
+  }
+};
+#endif
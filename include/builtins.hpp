@@ -0,0 +1,124 @@
+#ifndef __BUILTINS_HPP
+#define __BUILTINS_HPP
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "node.hpp"
+#include "symbol.hpp"
+
+// Library functions the interpreter runs natively, without a frame. Linker binds a call to one when no declaration
+// in scope takes its name, so a program defining its own `max` keeps calling it. Each operand has a role:
+// - VALUE: an int;
+// - LVALUE: a variable or an array element, read and written;
+// - NAME: a variable or an array, of which only the size is used;
+// - POINTER: `a` or `a + k`, row k of the array `a` as in C++ pointer arithmetic; the array is read and written.
+struct BuiltinInfo {
+  enum Role : std::uint8_t { VALUE, LVALUE, NAME, POINTER };
+  const char *name;
+  std::vector<Role> roles;
+
+  // no side effects
+  bool pure() const {
+    auto writes = [](Role r) { return r == LVALUE || r == POINTER; };
+    return !roles.empty() && std::none_of(roles.begin(), roles.end(), writes);
+  }
+  // takes ints only, so it can be evaluated on constants and its operands rewritten like any expression
+  bool scalar() const {
+    return !roles.empty() && std::all_of(roles.begin(), roles.end(), [](Role r) { return r == VALUE; });
+  }
+};
+
+// indexed by Builtin
+inline const BuiltinInfo &builtin_info(Builtin _id) {
+  static const BuiltinInfo table[] = {
+  {"", {}},
+  {"max", {BuiltinInfo::VALUE, BuiltinInfo::VALUE}},
+  {"min", {BuiltinInfo::VALUE, BuiltinInfo::VALUE}},
+  {"abs", {BuiltinInfo::VALUE}},
+  {"swap", {BuiltinInfo::LVALUE, BuiltinInfo::LVALUE}},
+  {"sizeof", {BuiltinInfo::NAME}},
+  {"memset", {BuiltinInfo::POINTER, BuiltinInfo::VALUE, BuiltinInfo::VALUE}},
+  {"fill", {BuiltinInfo::POINTER, BuiltinInfo::POINTER, BuiltinInfo::VALUE}},
+  {"sort", {BuiltinInfo::POINTER, BuiltinInfo::POINTER}},
+  };
+  return table[static_cast<std::size_t>(_id)];
+}
+
+// the builtin named `_name`, NONE if there is none
+inline Builtin find_builtin(Symbol _name) {
+  static const auto ids = [] {
+    std::unordered_map<Symbol, Builtin> res;
+    for (auto id = Builtin::MAX; id <= Builtin::SORT; id = static_cast<Builtin>(static_cast<int>(id) + 1)) {
+      res[intern(builtin_info(id).name)] = id;
+    }
+    return res;
+  }();
+  auto it = ids.find(_name);
+  return it == ids.end() ? Builtin::NONE : it->second;
+}
+
+// `a` or `a + k` as a POINTER operand: the array named and the slot of k, null for `a`
+inline bool pointer_operand(const std::shared_ptr<Node> &_arg, Symbol &_name, std::shared_ptr<Node> *&_offset) {
+  _offset = nullptr;
+  auto node = _arg.get();
+  if (node->kind == NodeKind::BIN && static_cast<BinNode *>(node)->op == TokenType::PLUS) {
+    _offset = &static_cast<BinNode *>(node)->r;
+    node = static_cast<BinNode *>(node)->l.get();
+  }
+  if (node->kind != NodeKind::VAR) {
+    return false;
+  }
+  _name = static_cast<VarNode *>(node)->var_name;
+  return true;
+}
+
+// whether the operands of a call bound to `_id` have the shapes their roles take; both ends of a range must point
+// into the same array
+inline bool builtin_operands_fit(Builtin _id, const std::vector<std::shared_ptr<Node>> &_args) {
+  auto &roles = builtin_info(_id).roles;
+  if (_args.size() != roles.size()) {
+    return false;
+  }
+  std::vector<Symbol> arrays;
+  for (std::size_t i = 0; i < roles.size(); ++i) {
+    auto kind = _args[i]->kind;
+    Symbol name;
+    std::shared_ptr<Node> *offset;
+    switch (roles[i]) {
+      case BuiltinInfo::LVALUE:
+        if (kind != NodeKind::VAR && kind != NodeKind::ARR_ACC) {
+          return false;
+        }
+        break;
+      case BuiltinInfo::NAME:
+        if (kind != NodeKind::VAR) {
+          return false;
+        }
+        break;
+      case BuiltinInfo::POINTER:
+        if (!pointer_operand(_args[i], name, offset)) {
+          return false;
+        }
+        arrays.push_back(name);
+        break;
+      default:
+        break;
+    }
+  }
+  return std::adjacent_find(arrays.begin(), arrays.end(), std::not_equal_to<Symbol>()) == arrays.end();
+}
+
+// max, min and abs; abs wraps like the interpreter's arithmetic
+inline int apply_builtin(Builtin _id, int _a, int _b = 0) {
+  switch (_id) {
+    case Builtin::MAX:
+      return std::max(_a, _b);
+    case Builtin::MIN:
+      return std::min(_a, _b);
+    default:
+      return _a < 0 ? static_cast<int>(0u - static_cast<unsigned>(_a)) : _a;
+  }
+}
+#endif
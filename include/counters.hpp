@@ -0,0 +1,168 @@
+#ifndef __COUNTERS_HPP
+#define __COUNTERS_HPP
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Hardware counters of the calling thread, through perf_event_open, for --counters. Each event is opened on its own
+// and left out when the kernel, the CPU or the container does not offer it; those opened are read as one group, in
+// a single system call. Kernel and hypervisor time are not counted. The task clock, a software event, is there where
+// the CPU counters are not.
+class PerfCounters {
+  public:
+  static constexpr std::size_t events = 6;
+  typedef std::array<std::uint64_t, events> Values;
+
+  protected:
+  struct Event {
+    const char *name;
+    std::uint32_t type;
+    std::uint64_t config;
+  };
+  static constexpr std::array<Event, events> table = {{
+  {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+  {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+  {"branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+  {"L1d-misses", PERF_TYPE_HW_CACHE,
+   PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+  {"LLC-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+  {"task-clock ns", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+  }};
+
+  int leader = -1;
+  std::array<int, events> fds;
+  std::array<std::size_t, events> slots;  // of the opened events in a group read
+  std::size_t opened = 0;
+  std::string error;  // of the first event that did not open
+
+  public:
+  PerfCounters() {
+    fds.fill(-1);
+    for (std::size_t i = 0; i < events; ++i) {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = table[i].type;
+      attr.config = table[i].config;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      auto fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+      if (fd < 0) {
+        if (error.empty()) {
+          error = std::strerror(errno);
+        }
+        continue;
+      }
+      if (leader < 0) {
+        leader = fd;
+      }
+      fds[i] = fd;
+      slots[i] = opened++;
+    }
+  }
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+  ~PerfCounters() {
+    for (auto fd : fds) {
+      if (fd >= 0) {
+        close(fd);
+      }
+    }
+  }
+
+  static const char *name(std::size_t _event) { return table[_event].name; }
+  bool available() const { return opened != 0; }
+  bool has(std::size_t _event) const { return fds[_event] >= 0; }
+
+  // counts since the counters were opened, scaled up when the kernel multiplexed them; 0 for the events not opened
+  Values read() const {
+    Values res{};
+    if (leader < 0) {
+      return res;
+    }
+    std::array<std::uint64_t, 3 + events> buf{};
+    if (::read(leader, buf.data(), sizeof(buf)) < 0) {
+      return res;
+    }
+    auto enabled = buf[1], running = buf[2];
+    auto scale = running != 0 ? static_cast<double>(enabled) / static_cast<double>(running) : 0.0;
+    for (std::size_t i = 0; i < events; ++i) {
+      if (has(i)) {
+        auto value = buf[3 + slots[i]];
+        res[i] = running == enabled ? value : static_cast<std::uint64_t>(static_cast<double>(value) * scale);
+      }
+    }
+    return res;
+  }
+
+  static void add(Values &to, const Values &from, const Values &since) {
+    for (std::size_t i = 0; i < events; ++i) {
+      to[i] += from[i] - since[i];
+    }
+  }
+
+  // the opened counts of `values` on the rest of a line
+  void print(std::ostream &os, const Values &values) const {
+    for (std::size_t i = 0; i < events; ++i) {
+      if (has(i)) {
+        os << ", " << values[i] << ' ' << name(i);
+      }
+    }
+  }
+  // the events that did not open, if any
+  void print_missing(std::ostream &os) const {
+    if (opened == events) {
+      return;
+    }
+    os << "Counters unavailable (" << error << "):";
+    for (std::size_t i = 0; i < events; ++i) {
+      if (!has(i)) {
+        os << ' ' << name(i);
+      }
+    }
+    os << '\n';
+  }
+};
+
+// Counts of the phases of a run, in the order they ran; with no counters, the phases just run.
+class PhaseCounters {
+  protected:
+  const PerfCounters *counters;
+  std::vector<std::pair<const char *, PerfCounters::Values>> rows;
+
+  public:
+  PhaseCounters(const PerfCounters *_counters = nullptr) : counters(_counters) {}
+
+  bool enabled() const { return counters != nullptr && counters->available(); }
+
+  template <typename F>
+  void measure(const char *_name, F &&f) {
+    if (!enabled()) {
+      f();
+      return;
+    }
+    auto before = counters->read();
+    f();
+    auto &row = rows.emplace_back(_name, PerfCounters::Values{}).second;
+    PerfCounters::add(row, counters->read(), before);
+  }
+
+  void print(std::ostream &os) const {
+    for (auto &[phase, values] : rows) {
+      os << phase << " phase";
+      counters->print(os, values);
+      os << '\n';
+    }
+  }
+};
+#endif
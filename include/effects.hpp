@@ -0,0 +1,285 @@
+#ifndef __EFFECTS_HPP
+#define __EFFECTS_HPP
+#include <unordered_map>
+#include <unordered_set>
+
+#include "builtins.hpp"
+#include "walker.hpp"
+
+// Side effects of a function, including those of everything it calls. Variables are dynamically scoped, so
+// the names a function reads or writes without declaring them reach whatever binding of that name is visible
+// to its caller.
+// Array parameters are bound to the caller's arrays, so writing one writes the array passed in.
+struct Effects {
+  // an array passed to an array parameter of a call: a free name, or the `own` parameter of this function
+  struct RefArg {
+    const FnDeclNode *callee;
+    std::size_t param;
+    Symbol sym;
+    std::size_t own;  // SIZE_MAX for a free name
+  };
+
+  std::unordered_set<Symbol> reads, writes;  // free names, scalars and arrays alike
+  std::unordered_set<std::size_t> ref_writes;  // array parameters written, by position
+  bool io = false;
+  bool unknown = false;    // calls something that is bound to neither a declaration nor a builtin
+  bool ambiguous = false;  // a name refers to different bindings at different points of the body
+  std::vector<FnDeclNode *> callees;
+  std::vector<RefArg> ref_args;
+
+  bool pure() const { return writes.empty() && ref_writes.empty() && !io && !unknown; }
+};
+
+class EffectsAnalyzer {
+  protected:
+  std::unordered_map<const FnDeclNode *, Effects> fns;
+  Effects root_effects;
+
+  // local (not transitive) effects of one body
+  class Collector {
+protected:
+    Effects &eff;
+    std::vector<std::unordered_set<Symbol>> scopes;
+    std::unordered_set<Symbol> declared_any, free_any;
+    std::unordered_map<Symbol, std::size_t> params;  // array parameters, by position
+
+    bool is_local(Symbol sym) const {
+      for (auto &i : scopes) {
+        if (i.contains(sym)) {
+          return true;
+        }
+      }
+      return false;
+    }
+    void declare(Symbol sym) {
+      if (is_local(sym) || free_any.contains(sym)) {
+        eff.ambiguous = true;
+      }
+      scopes.back().insert(sym);
+      declared_any.insert(sym);
+    }
+    void use(Symbol sym, bool write) {
+      if (is_local(sym)) {
+        return;
+      }
+      if (declared_any.contains(sym)) {
+        eff.ambiguous = true;
+      }
+      free_any.insert(sym);
+      (write ? eff.writes : eff.reads).insert(sym);
+    }
+    void stmts(std::vector<std::shared_ptr<Node>> &list) {
+      for (auto &i : list) {
+        if (i != nullptr) {
+          visit(*i);
+        }
+      }
+    }
+    void scoped(BlockNode &block) {
+      scopes.emplace_back();
+      stmts(block.children);
+      scopes.pop_back();
+    }
+    // assignment targets and cin operands
+    void target(Node &node) {
+      if (auto var = dynamic_cast<VarNode *>(&node)) {
+        use(var->var_name, true);
+      } else if (auto acc = dynamic_cast<ArrAccessNode *>(&node)) {
+        stmts(acc->dimensions);
+        if (auto param = params.find(acc->name); param != params.end()) {
+          eff.ref_writes.insert(param->second);
+        }
+        use(acc->name, true);
+      } else {
+        visit(node);
+      }
+    }
+
+    // arrays passed by reference; a local one cannot be seen by the caller. The extents of the parameters are
+    // evaluated by the call.
+    void ref_args(FnCallNode &call) {
+      for (std::size_t i = 0; i < call.call_params.size(); ++i) {
+        auto &param = *call.fn->params[i];
+        if (param.dimensions.empty()) {
+          continue;
+        }
+        stmts(param.dimensions);
+        auto sym = static_cast<VarNode &>(*call.call_params[i]).var_name;
+        if (auto own = params.find(sym); own != params.end()) {
+          eff.ref_args.push_back({call.fn, i, sym, own->second});
+        } else if (!is_local(sym)) {
+          eff.ref_args.push_back({call.fn, i, sym, SIZE_MAX});
+        }
+      }
+    }
+
+    // operands of a call bound to a builtin, by role
+    void builtin(FnCallNode &call) {
+      auto &roles = builtin_info(call.builtin).roles;
+      for (std::size_t i = 0; i < roles.size(); ++i) {
+        auto &arg = *call.call_params[i];
+        Symbol sym;
+        std::shared_ptr<Node> *offset;
+        if (roles[i] == BuiltinInfo::LVALUE) {
+          visit(arg);
+          target(arg);
+        } else if (roles[i] == BuiltinInfo::POINTER && pointer_operand(call.call_params[i], sym, offset)) {
+          if (offset != nullptr) {
+            visit(**offset);
+          }
+          if (auto param = params.find(sym); param != params.end()) {
+            eff.ref_writes.insert(param->second);
+          }
+          use(sym, false);
+          use(sym, true);
+        } else {
+          visit(arg);
+        }
+      }
+    }
+
+    void visit(Node &node) {
+      if (dynamic_cast<FnDeclNode *>(&node)) {
+        return;
+      }
+      if (auto var = dynamic_cast<VarNode *>(&node)) {
+        use(var->var_name, false);
+      } else if (auto decl = dynamic_cast<VarDeclNode *>(&node)) {
+        visit(*decl->var_value);
+        declare(decl->var->var_name);
+      } else if (auto arr_decl = dynamic_cast<ArrDeclNode *>(&node)) {
+        stmts(arr_decl->dimensions);
+        declare(arr_decl->name);
+      } else if (auto assign = dynamic_cast<AssignNode *>(&node)) {
+        target(*assign->l);
+        visit(*assign->r);
+      } else if (auto acc = dynamic_cast<ArrAccessNode *>(&node)) {
+        stmts(acc->dimensions);
+        use(acc->name, false);
+      } else if (auto io_in = dynamic_cast<IOInNode *>(&node)) {
+        eff.io = true;
+        for (auto &i : io_in->body) {
+          target(*i);
+        }
+      } else if (auto io_out = dynamic_cast<IOOutNode *>(&node)) {
+        eff.io = true;
+        stmts(io_out->body);
+      } else if (auto call = dynamic_cast<FnCallNode *>(&node)) {
+        if (call->builtin != Builtin::NONE) {
+          builtin(*call);
+        } else if (call->fn == nullptr) {
+          stmts(call->call_params);
+          eff.unknown = true;
+        } else {
+          stmts(call->call_params);
+          eff.callees.push_back(call->fn);
+          ref_args(*call);
+        }
+      } else if (auto scope = dynamic_cast<ScopeNode *>(&node)) {
+        scoped(*scope->block);
+      } else if (auto forl = dynamic_cast<ForLoopNode *>(&node)) {
+        scopes.emplace_back();
+        stmts(forl->init);
+        if (forl->cond != nullptr) {
+          visit(*forl->cond);
+        }
+        stmts(forl->upd);
+        stmts(forl->body->children);
+        scopes.pop_back();
+      } else if (auto whilel = dynamic_cast<WhileLoopNode *>(&node)) {
+        visit(*whilel->cond);
+        scoped(*whilel->body);
+      } else if (auto ifn = dynamic_cast<IfNode *>(&node)) {
+        visit(*ifn->if_bl.first);
+        scoped(*ifn->if_bl.second);
+        for (auto &elif : ifn->elif_bl) {
+          visit(*elif.first);
+          scoped(*elif.second);
+        }
+        if (ifn->else_bl != nullptr) {
+          scoped(*ifn->else_bl);
+        }
+      } else {
+        for_each_child(node, [this](auto &child) { visit(*child); });
+      }
+    }
+
+public:
+    Collector(Effects &_eff) : eff(_eff) {}
+    void run(BlockNode &body, const std::vector<std::shared_ptr<ParamsDeclNode>> &_params) {
+      scopes.emplace_back();
+      for (std::size_t i = 0; i < _params.size(); ++i) {
+        declare(_params[i]->var->var_name);
+        if (!_params[i]->dimensions.empty()) {
+          params[_params[i]->var->var_name] = i;
+        }
+      }
+      stmts(body.children);
+    }
+  };
+
+  // adds the effects of the callees of `eff`, returns whether that changed anything
+  bool inherit(Effects &eff) {
+    auto before = eff.reads.size() + eff.writes.size() + eff.ref_writes.size() + eff.io + eff.unknown;
+    for (auto callee : eff.callees) {
+      auto &sub = fns.at(callee);
+      if (&sub == &eff) {
+        continue;
+      }
+      eff.reads.insert(sub.reads.begin(), sub.reads.end());
+      eff.writes.insert(sub.writes.begin(), sub.writes.end());
+      eff.io |= sub.io;
+      eff.unknown |= sub.unknown;
+    }
+    for (auto &i : eff.ref_args) {
+      if (!fns.at(i.callee).ref_writes.contains(i.param)) {
+        continue;
+      }
+      if (i.own == SIZE_MAX) {
+        eff.writes.insert(i.sym);
+      } else {
+        eff.ref_writes.insert(i.own);
+      }
+    }
+    return before != eff.reads.size() + eff.writes.size() + eff.ref_writes.size() + eff.io + eff.unknown;
+  }
+
+  public:
+  void run(ScopeNode &root) {
+    Collector(root_effects).run(*root.block, {});
+    walk(root, [this](Node &node) {
+      if (auto fn = dynamic_cast<FnDeclNode *>(&node)) {
+        Collector(fns[fn]).run(*fn->block, fn->params);
+      }
+      return true;
+    });
+    // propagate callee effects to callers until nothing changes
+    for (bool changed = true; changed;) {
+      changed = false;
+      for (auto &[fn, eff] : fns) {
+        changed |= inherit(eff);
+      }
+    }
+    inherit(root_effects);
+  }
+
+  // effects of a block on its own, without those of its callees
+  static Effects of_block(BlockNode &block) {
+    Effects res;
+    Collector(res).run(block, {});
+    return res;
+  }
+  const Effects &of(const FnDeclNode *fn) const { return fns.at(fn); }
+  // calls f(sym) for every array a call passes to a parameter its callee writes
+  template <typename F>
+  void ref_writes(const FnCallNode &call, F &&f) const {
+    if (call.fn == nullptr) {
+      return;
+    }
+    for (auto param : fns.at(call.fn).ref_writes) {
+      f(static_cast<const VarNode &>(*call.call_params[param]).var_name);
+    }
+  }
+  const Effects &of_root() const { return root_effects; }
+};
+#endif
@@ -10,6 +10,9 @@ enum class ErrMsg {
   UNS_SYNT,
   INV_DT_TYPE,
   INV_ARGS,
+  ARR_OOB,
+  ARR_SIZE,
+  DIV_ZERO,
 };
 
 inline std::string get_err(const ErrMsg &_e) {
@@ -28,6 +31,12 @@ inline std::string get_err(const ErrMsg &_e) {
       return "Type error: Unknown type";
     case ErrMsg::INV_ARGS:
       return "Type error: Invalid arguments list for function";
+    case ErrMsg::ARR_OOB:
+      return "Runtime error: Array index out of bounds";
+    case ErrMsg::ARR_SIZE:
+      return "Runtime error: Invalid array size";
+    case ErrMsg::DIV_ZERO:
+      return "Runtime error: Division by zero";
     default:
       return "Unknown runtime error";
   }
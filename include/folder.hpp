@@ -0,0 +1,105 @@
+#ifndef __FOLDER_HPP
+#define __FOLDER_HPP
+#include <map>
+#include <optional>
+#include <type_traits>
+
+#include "effects.hpp"
+#include "interpreter.hpp"
+
+// Partial evaluation ahead of execution. Constant BinNode/UnaryNode subtrees become NumNode literals, and so do
+// calls of max, min and abs with constant arguments, and calls with constant arguments to functions that have no
+// side effects and read no free names: those are run on a scratch Interpreter. All such calls share one budget of
+// interpreter operations (see Governor); a call that runs out of it or fails at compile time stays a call, so its
+// error is still raised if it is executed.
+class PartialEvaluator {
+  protected:
+  static constexpr std::size_t max_memory = 64 << 20, max_depth = 1000;
+
+  const EffectsAnalyzer &effects;
+  std::uint64_t budget;
+  std::map<std::pair<const FnDeclNode *, std::vector<int>>, std::optional<int>> memo;
+
+  static NumNode *literal(const std::shared_ptr<Node> &node) { return dynamic_cast<NumNode *>(node.get()); }
+  static std::shared_ptr<Node> make_literal(int value) { return std::make_shared<NumNode>(std::to_string(value)); }
+
+  std::optional<int> call(FnCallNode &fn_call) {
+    auto &eff = effects.of(fn_call.fn);
+    if (!eff.pure() || !eff.reads.empty() || eff.ambiguous) {
+      return std::nullopt;
+    }
+    std::vector<int> args;
+    for (auto &i : fn_call.call_params) {
+      auto num = literal(i);
+      if (num == nullptr) {
+        return std::nullopt;
+      }
+      args.push_back(num->value);
+    }
+    auto [it, inserted] = memo.try_emplace({fn_call.fn, std::move(args)});
+    if (!inserted || budget == 0) {
+      return it->second;
+    }
+    Limits limits;
+    limits.max_ops = budget;
+    limits.max_memory = max_memory;
+    limits.max_depth = max_depth;
+    Interpreter<GovernedPolicy> interpreter(limits);
+    try {
+      it->second = interpreter.vi(fn_call);
+    } catch (const std::exception &) {
+      // left to fail, or run out of budget, at run time
+    }
+    auto ops = std::min(interpreter.stats().ops, budget);
+    budget -= ops;
+    steps += ops;
+    return it->second;
+  }
+
+  public:
+  std::size_t exprs = 0, calls = 0;
+  std::uint64_t steps = 0;
+
+  PartialEvaluator(const EffectsAnalyzer &_effects, std::uint64_t _budget) : effects(_effects), budget(_budget) {}
+
+  void fold(Node &node) {
+    for_each_child(node, [this](auto &child) {
+      if constexpr (std::is_same_v<std::decay_t<decltype(child)>, std::shared_ptr<Node>>) {
+        fold(child);
+      } else {
+        fold(*child);
+      }
+    });
+  }
+  // folds the subtree in `slot`, children first
+  void fold(std::shared_ptr<Node> &slot) {
+    fold(*slot);
+    if (auto bin = dynamic_cast<BinNode *>(slot.get())) {
+      auto l = literal(bin->l), r = literal(bin->r);
+      if (l == nullptr || r == nullptr ||
+          ((bin->op == TokenType::DIV || bin->op == TokenType::MOD) && r->value == 0)) {
+        return;
+      }
+      slot = make_literal(Interpreter<>::apply_bin(bin->op, l->value, r->value));
+      exprs++;
+    } else if (auto un = dynamic_cast<UnaryNode *>(slot.get())) {
+      if (auto sub = literal(un->expr)) {
+        slot = make_literal(Interpreter<>::apply_unary(un->op, sub->value));
+        exprs++;
+      }
+    } else if (auto fn_call = dynamic_cast<FnCallNode *>(slot.get()); fn_call != nullptr && fn_call->fn != nullptr) {
+      if (auto res = call(*fn_call)) {
+        slot = make_literal(*res);
+        calls++;
+      }
+    } else if (fn_call != nullptr && builtin_info(fn_call->builtin).scalar()) {
+      auto &args = fn_call->call_params;
+      if (std::all_of(args.begin(), args.end(), [](const auto &i) { return literal(i) != nullptr; })) {
+        auto a = literal(args[0])->value, b = args.size() > 1 ? literal(args[1])->value : 0;
+        slot = make_literal(apply_builtin(fn_call->builtin, a, b));
+        exprs++;
+      }
+    }
+  }
+};
+#endif
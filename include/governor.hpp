@@ -0,0 +1,135 @@
+#ifndef __GOVERNOR_HPP
+#define __GOVERNOR_HPP
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+// A zero limit means unlimited.
+struct Limits {
+  std::uint64_t max_ops = 0;
+  std::chrono::milliseconds time_limit{0};
+  std::size_t max_memory = 0;
+  std::size_t max_depth = 0;
+};
+
+enum class Resource {
+  OPS,
+  TIME,
+  MEMORY,
+  DEPTH,
+};
+
+// Process exit status when a limit stops the program. 1 is reserved for ordinary runtime errors.
+inline int get_exit_status(const Resource &_r) {
+  switch (_r) {
+    case Resource::OPS:
+      return 3;
+    case Resource::TIME:
+      return 4;
+    case Resource::MEMORY:
+      return 5;
+    case Resource::DEPTH:
+      return 6;
+    default:
+      return 1;
+  }
+}
+
+inline std::string get_resource_name(const Resource &_r) {
+  switch (_r) {
+    case Resource::OPS:
+      return "operation budget";
+    case Resource::TIME:
+      return "time limit";
+    case Resource::MEMORY:
+      return "memory limit";
+    case Resource::DEPTH:
+      return "call depth limit";
+    default:
+      return "unknown limit";
+  }
+}
+
+class ResourceExhausted : public std::runtime_error {
+  public:
+  Resource resource;
+  ResourceExhausted(const Resource &_r)
+      : std::runtime_error("Resource error: " + get_resource_name(_r) + " exceeded"), resource(_r) {}
+};
+
+// Counts executed operations (loop back-edges and calls) and enforces the limits. The operation counter is a
+// countdown of fuel; the budget and the wall clock are only looked at when a slice of fuel runs out.
+class Governor {
+  protected:
+  static constexpr std::uint64_t slice = 1 << 14;
+
+  Limits limits;
+  std::chrono::steady_clock::time_point start;
+  std::uint64_t fuel = 0, granted = 0, spent = 0;
+
+  void refuel() {
+    spent += granted;
+    granted = 0;
+    if (limits.max_ops != 0 && spent >= limits.max_ops) {
+      throw ResourceExhausted(Resource::OPS);
+    }
+    if (limits.time_limit.count() != 0 && elapsed() >= limits.time_limit) {
+      throw ResourceExhausted(Resource::TIME);
+    }
+    granted = limits.max_ops == 0 ? slice : std::min(slice, limits.max_ops - spent);
+    fuel = granted;
+  }
+
+  public:
+  Governor(const Limits &_limits = {}) : limits(_limits), start(std::chrono::steady_clock::now()) {}
+
+  void tick() {
+    if (fuel == 0) {
+      refuel();
+    }
+    fuel--;
+  }
+  // `n` operations at once
+  void tick(std::uint64_t n) {
+    while (n > fuel) {
+      n -= fuel;
+      fuel = 0;
+      refuel();
+    }
+    fuel -= n;
+  }
+  // `in_use` bytes are held already and `bytes` more are about to be allocated
+  void reserve(std::size_t in_use, std::size_t bytes) const {
+    if (limits.max_memory != 0 && (bytes > limits.max_memory || in_use > limits.max_memory - bytes)) {
+      throw ResourceExhausted(Resource::MEMORY);
+    }
+  }
+  void check_depth(std::size_t depth) const {
+    if (limits.max_depth != 0 && depth > limits.max_depth) {
+      throw ResourceExhausted(Resource::DEPTH);
+    }
+  }
+
+  // what is left of the limits for a helper running alongside, given `in_use` bytes held already
+  Limits share(std::size_t in_use) const {
+    auto res = limits;
+    if (res.max_ops != 0) {
+      res.max_ops -= std::min(res.max_ops - 1, ops());
+    }
+    if (res.time_limit.count() != 0) {
+      res.time_limit = std::max(res.time_limit - elapsed(), std::chrono::milliseconds(1));
+    }
+    if (res.max_memory != 0) {
+      res.max_memory -= std::min(res.max_memory - 1, in_use);
+    }
+    return res;
+  }
+
+  std::uint64_t ops() const { return spent + granted - fuel; }
+  std::chrono::milliseconds elapsed() const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+  }
+};
+#endif
@@ -0,0 +1,141 @@
+#ifndef __GREEN_HPP
+#define __GREEN_HPP
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include "governor.hpp"
+
+// Runs many jobs on the calling thread, each on a stack of its own, switching between them only where a job calls
+// checkpoint(). Once the running job has used up its slice there, it goes to the back of the line, so a slow job
+// holds up each of the others for a slice at most. A job that has run for its time limit in total is stopped by the
+// ResourceExhausted thrown from checkpoint(); time spent waiting for a turn does not count.
+// Stacks are mapped on a job's first turn and unmapped when it returns, with a guard page below; only the pages a
+// job touches take memory. stack_limit() tells a job where it is about to run out.
+class Scheduler {
+  public:
+  // runs a job to its end; must not throw
+  typedef std::function<void()> Body;
+  typedef std::chrono::steady_clock Clock;
+
+  protected:
+  // kept free below the stack pointer for what runs between two checks against stack_limit()
+  static constexpr std::size_t margin = std::size_t(64) << 10;
+
+  struct Job {
+    Body body;
+    ucontext_t ctx;
+    char *stack = nullptr;  // the guard page first
+    char *low = nullptr;    // the lowest usable byte
+    Clock::duration used{};
+    bool done = false;
+  };
+
+  std::size_t stack_bytes, page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  Clock::duration slice, limit;
+  std::vector<std::unique_ptr<Job>> jobs;
+  ucontext_t main_ctx;
+  Job *cur = nullptr;
+  Clock::time_point slice_start;
+
+  static inline thread_local Scheduler *running = nullptr;
+
+  static void enter() {
+    running->cur->body();
+    running->cur->done = true;
+    // back to run() through uc_link
+  }
+
+  void map_stack(Job &job) {
+    auto p = mmap(nullptr, stack_bytes + page, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+    if (p == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+    mprotect(p, page, PROT_NONE);
+    job.stack = static_cast<char *>(p);
+    job.low = job.stack + page;
+    getcontext(&job.ctx);
+    job.ctx.uc_stack.ss_sp = job.low;
+    job.ctx.uc_stack.ss_size = stack_bytes;
+    job.ctx.uc_link = &main_ctx;
+    makecontext(&job.ctx, enter, 0);
+  }
+  void unmap_stack(Job &job) {
+    munmap(job.stack, stack_bytes + page);
+    job.stack = nullptr;
+  }
+
+  public:
+  // `_limit` of zero runs jobs for as long as they take
+  Scheduler(std::size_t _stack_bytes, Clock::duration _slice, Clock::duration _limit = {})
+      : stack_bytes(std::max(_stack_bytes, 2 * margin)), slice(_slice), limit(_limit) {}
+  Scheduler(const Scheduler &) = delete;
+  Scheduler &operator=(const Scheduler &) = delete;
+
+  void add(Body _body) {
+    jobs.push_back(std::make_unique<Job>());
+    jobs.back()->body = std::move(_body);
+  }
+
+  // runs the jobs until all of them have returned
+  void run() {
+    std::deque<Job *> ready;
+    for (auto &job : jobs) {
+      ready.push_back(job.get());
+    }
+    auto outer = std::exchange(running, this);
+    while (!ready.empty()) {
+      cur = ready.front();
+      ready.pop_front();
+      if (cur->stack == nullptr) {
+        map_stack(*cur);
+      }
+      slice_start = Clock::now();
+      swapcontext(&main_ctx, &cur->ctx);
+      cur->used += Clock::now() - slice_start;
+      if (cur->done) {
+        unmap_stack(*cur);
+        cur->body = nullptr;
+      } else {
+        ready.push_back(cur);
+      }
+    }
+    cur = nullptr;
+    running = outer;
+  }
+
+  // from a job: lets the others run once it has used its slice
+  static void checkpoint() {
+    auto self = running;
+    if (self == nullptr || self->cur == nullptr) {
+      return;
+    }
+    auto ran = Clock::now() - self->slice_start;
+    if (self->limit.count() != 0 && self->cur->used + ran >= self->limit) {
+      throw ResourceExhausted(Resource::TIME);
+    }
+    if (ran >= self->slice) {
+      swapcontext(&self->cur->ctx, &self->main_ctx);
+    }
+  }
+  // from a job: the address below which its stack is about to run out; 0 outside a job
+  static std::uintptr_t stack_limit() {
+    auto self = running;
+    if (self == nullptr || self->cur == nullptr) {
+      return 0;
+    }
+    return reinterpret_cast<std::uintptr_t>(self->cur->low) + margin;
+  }
+};
+#endif
@@ -0,0 +1,206 @@
+#ifndef __IDIOMS_HPP
+#define __IDIOMS_HPP
+#include "bounds.hpp"
+
+// Loop idiom recognition. A loop `for (...; iv < bound; iv = iv + 1)` whose body is a single fill, copy, sum,
+// max/min or prefix-sum statement over the last dimension of arrays gets a LoopIdiom, and the interpreter runs it
+// as a native kernel (see Kernels). The loop itself stays in the tree: it runs instead whenever the kernel cannot
+// be shown to have the same effect at loop entry, e.g. an index is out of bounds, so errors are raised as before.
+class IdiomRecognizer {
+  protected:
+  std::size_t counts[LoopIdiom::PREFIX + 1] = {};
+
+  // structural equality of loop-invariant expressions
+  static bool same(const Node &a, const Node &b) {
+    if (auto num = dynamic_cast<const NumNode *>(&a)) {
+      auto other = dynamic_cast<const NumNode *>(&b);
+      return other != nullptr && other->value == num->value;
+    }
+    if (auto var = dynamic_cast<const VarNode *>(&a)) {
+      auto other = dynamic_cast<const VarNode *>(&b);
+      return other != nullptr && other->var_name == var->var_name;
+    }
+    if (auto bin = dynamic_cast<const BinNode *>(&a)) {
+      auto other = dynamic_cast<const BinNode *>(&b);
+      return other != nullptr && other->op == bin->op && same(*bin->l, *other->l) && same(*bin->r, *other->r);
+    }
+    if (auto un = dynamic_cast<const UnaryNode *>(&a)) {
+      auto other = dynamic_cast<const UnaryNode *>(&b);
+      return other != nullptr && other->op == un->op && same(*un->expr, *other->expr);
+    }
+    return false;
+  }
+  // same array and leading indices
+  static bool same_row(const IdiomOperand &a, const IdiomOperand &b) {
+    if (a.acc->name != b.acc->name || a.acc->dimensions.size() != b.acc->dimensions.size()) {
+      return false;
+    }
+    for (std::size_t dim = 0; dim + 1 < a.acc->dimensions.size(); ++dim) {
+      if (!same(*a.acc->dimensions[dim], *b.acc->dimensions[dim])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // an access whose last index is `iv + off`; the leading ones are checked by invariant()
+  static bool operand(const std::shared_ptr<Node> &node, Symbol iv, IdiomOperand &op) {
+    auto acc = dynamic_cast<ArrAccessNode *>(node.get());
+    if (acc == nullptr || acc->dimensions.empty() ||
+        !BoundsAnalyzer::index_offset(acc->dimensions.back(), iv, op.off)) {
+      return false;
+    }
+    op.acc = acc;
+    return true;
+  }
+
+  // `if (a[iv] > m) { m = a[iv]; }`, with any of < <= > >= and either operand order
+  static bool extremum(IfNode &ifn, LoopIdiom &idm) {
+    auto cond = dynamic_cast<BinNode *>(ifn.if_bl.first.get());
+    if (cond == nullptr || !ifn.elif_bl.empty() || ifn.else_bl != nullptr || ifn.if_bl.second->children.size() != 1) {
+      return false;
+    }
+    auto assign = dynamic_cast<AssignNode *>(ifn.if_bl.second->children[0].get());
+    auto var = assign != nullptr ? dynamic_cast<VarNode *>(assign->l.get()) : nullptr;
+    if (var == nullptr || var->var_name == idm.iv || !operand(assign->r, idm.iv, idm.src)) {
+      return false;
+    }
+    idm.acc = var->var_name;
+    bool less;
+    switch (cond->op) {
+      case TokenType::CMP_LES:
+      case TokenType::CMP_LTE:
+        less = true;
+        break;
+      case TokenType::CMP_GRT:
+      case TokenType::CMP_GTE:
+        less = false;
+        break;
+      default:
+        return false;
+    }
+    // whether the element replaces `m` when it is greater
+    bool greater;
+    IdiomOperand elem;
+    if (operand(cond->l, idm.iv, elem) && BoundsAnalyzer::is_var(cond->r, idm.acc)) {
+      greater = !less;
+    } else if (BoundsAnalyzer::is_var(cond->l, idm.acc) && operand(cond->r, idm.iv, elem)) {
+      greater = less;
+    } else {
+      return false;
+    }
+    if (!same_row(elem, idm.src) || elem.off != idm.src.off) {
+      return false;
+    }
+    idm.kind = greater ? LoopIdiom::MAX : LoopIdiom::MIN;
+    return true;
+  }
+
+  static bool statement(Node &stmt, LoopIdiom &idm) {
+    if (auto ifn = dynamic_cast<IfNode *>(&stmt)) {
+      return extremum(*ifn, idm);
+    }
+    auto assign = dynamic_cast<AssignNode *>(&stmt);
+    if (assign == nullptr) {
+      return false;
+    }
+    auto bin = dynamic_cast<BinNode *>(assign->r.get());
+    auto plus = bin != nullptr && bin->op == TokenType::PLUS;
+    // s = s + a[iv]
+    if (auto var = dynamic_cast<VarNode *>(assign->l.get())) {
+      if (!plus || var->var_name == idm.iv) {
+        return false;
+      }
+      idm.kind = LoopIdiom::SUM;
+      idm.acc = var->var_name;
+      return (BoundsAnalyzer::is_var(bin->l, idm.acc) && operand(bin->r, idm.iv, idm.src)) ||
+             (operand(bin->l, idm.iv, idm.src) && BoundsAnalyzer::is_var(bin->r, idm.acc));
+    }
+    if (!operand(assign->l, idm.iv, idm.dst)) {
+      return false;
+    }
+    // a[iv] = b[iv + c]
+    if (operand(assign->r, idm.iv, idm.src)) {
+      idm.kind = LoopIdiom::COPY;
+      return true;
+    }
+    // a[iv] = a[iv - 1] + b[iv]
+    IdiomOperand l, r;
+    if (plus && operand(bin->l, idm.iv, l) && operand(bin->r, idm.iv, r)) {
+      auto is_prev = [&idm](const IdiomOperand &op) { return same_row(op, idm.dst) && op.off == idm.dst.off - 1; };
+      if (!is_prev(l) && !is_prev(r)) {
+        return false;
+      }
+      idm.prev = is_prev(l) ? l : r;
+      idm.src = is_prev(l) ? r : l;
+      idm.kind = LoopIdiom::PREFIX;
+      return true;
+    }
+    // a[iv] = v
+    idm.kind = LoopIdiom::FILL;
+    idm.value = assign->r;
+    return true;
+  }
+
+  // the bound, the stored value and the leading indices do not change while the loop runs, and evaluating them
+  // has no effect
+  static bool invariant(const LoopIdiom &idm) {
+    BoundsAnalyzer::Writes w;
+    w.names.insert(idm.iv);
+    if (idm.acc != 0) {
+      w.names.insert(idm.acc);
+    }
+    if (!BoundsAnalyzer::is_invariant(*idm.bound, w) ||
+        (idm.value != nullptr && !BoundsAnalyzer::is_invariant(*idm.value, w))) {
+      return false;
+    }
+    for (auto op : {&idm.dst, &idm.src, &idm.prev}) {
+      if (op->acc == nullptr) {
+        continue;
+      }
+      if (w.names.contains(op->acc->name)) {
+        return false;
+      }
+      for (std::size_t dim = 0; dim + 1 < op->acc->dimensions.size(); ++dim) {
+        if (!BoundsAnalyzer::is_invariant(*op->acc->dimensions[dim], w)) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  void match(ForLoopNode &forl) {
+    auto cond = dynamic_cast<BinNode *>(forl.cond.get());
+    if (cond == nullptr || (cond->op != TokenType::CMP_LES && cond->op != TokenType::CMP_LTE) ||
+        forl.upd.size() != 1 || forl.body->children.size() != 1) {
+      return;
+    }
+    auto iv = dynamic_cast<VarNode *>(cond->l.get());
+    int step;
+    if (iv == nullptr || !BoundsAnalyzer::loop_step(forl.upd[0], iv->var_name, step) || step != 1) {
+      return;
+    }
+    LoopIdiom idm;
+    idm.iv = iv->var_name;
+    idm.bound = cond->r;
+    idm.inclusive = cond->op == TokenType::CMP_LTE;
+    if (statement(*forl.body->children[0], idm) && invariant(idm)) {
+      counts[idm.kind]++;
+      forl.idiom = std::move(idm);
+    }
+  }
+
+  public:
+  void run(Node &root) {
+    walk(root, [this](Node &node) {
+      if (auto forl = dynamic_cast<ForLoopNode *>(&node)) {
+        match(*forl);
+      }
+      return true;
+    });
+  }
+
+  std::size_t count(LoopIdiom::Kind kind) const { return counts[kind]; }
+};
+#endif
@@ -0,0 +1,210 @@
+#ifndef __INCREMENTAL_HPP
+#define __INCREMENTAL_HPP
+#include <algorithm>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "bounds.hpp"
+#include "lexer.hpp"
+#include "linker.hpp"
+#include "parser.hpp"
+#include "scopes.hpp"
+
+// Keeps the top-level declarations of a program parsed across edits, for --watch. A source is split into
+// declarations (see Parser::split); a declaration whose text was seen in the last version keeps its nodes, moved to
+// its new line if need be, and only the others are lexed, parsed, analyzed (see BoundsAnalyzer, ScopeAnalyzer) and
+// linked. A function that is parsed again takes the place of its
+// old FnDeclNode, so calls elsewhere stay bound to it; the whole program is only relinked when the set of
+// functions or the parameters of one change.
+// The nodes stay unoptimized: the Optimizer works across functions and rewrites them in place, so its output
+// would go stale when a callee changes.
+class IncrementalParser {
+  protected:
+  struct Decl {
+    std::size_t begin, end;  // byte range in the source, without surrounding whitespace
+    std::uint64_t hash;
+    std::string text;
+    std::size_t line;  // of the first byte, which the nodes' locations are relative to
+    std::vector<std::shared_ptr<Node>> nodes;
+  };
+  typedef std::unordered_multimap<std::uint64_t, Decl> DeclMap;
+  typedef std::unordered_map<Symbol, std::shared_ptr<FnDeclNode>> FnMap;
+  // declarations of the last version, by hash, and the functions among them, by name
+  DeclMap cache;
+  FnMap fns;
+  std::size_t parsed = 0, reused = 0;
+
+  static void shift_lines(Node &root, std::ptrdiff_t delta) {
+    walk(root, [delta](Node &node) {
+      if (node.kind == NodeKind::ARR_ACC) {
+        auto &loc = static_cast<ArrAccessNode &>(node).loc;
+        loc.line = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(loc.line) + delta);
+      }
+      return true;
+    });
+  }
+
+  // calls `f` on the slot of every function the top-level statement `node` declares; declarations come wrapped in
+  // plain blocks, which Linker looks into
+  template <typename F>
+  static void each_fn(std::shared_ptr<Node> &node, F &&f) {
+    if (node->kind == NodeKind::FN_DECL) {
+      f(node);
+    } else if (node->kind == NodeKind::BLOCK) {
+      for (auto &child : static_cast<BlockNode &>(*node).children) {
+        each_fn(child, f);
+      }
+    }
+  }
+
+  // parameter ranks: all a call is linked against
+  static std::vector<std::size_t> signature(const FnDeclNode &fn) {
+    std::vector<std::size_t> res;
+    for (auto &param : fn.params) {
+      res.push_back(param->dimensions.size());
+    }
+    return res;
+  }
+
+  // the declaration at `range` of the last version, moved to start at `line`; nullptr if there is none
+  Decl *find(std::string_view text, std::uint64_t hash, std::size_t line, std::unordered_set<Decl *> &claimed) {
+    for (auto [it, last] = cache.equal_range(hash); it != last; ++it) {
+      auto decl = &it->second;
+      if (decl->text == text && claimed.insert(decl).second) {
+        if (decl->line != line) {
+          for (auto &node : decl->nodes) {
+            shift_lines(*node, static_cast<std::ptrdiff_t>(line) - static_cast<std::ptrdiff_t>(decl->line));
+          }
+          decl->line = line;
+        }
+        return decl;
+      }
+    }
+    return nullptr;
+  }
+
+  // parses the declaration `text` at `line`, padded to its column so that token locations come out as in the
+  // whole source
+  static std::vector<std::shared_ptr<Node>> parse(std::string_view text, std::size_t line, std::size_t col) {
+    auto padded = std::string(col, ' ') + std::string(text);
+    Lexer lexer(padded, line);
+    Parser parser(lexer);
+    auto res = std::move(parser.parse()->block->children);
+    for (auto &node : res) {
+      BoundsAnalyzer().run(*node);
+      ScopeAnalyzer().run(*node);
+    }
+    return res;
+  }
+
+  // moves the contents of functions parsed again into their old nodes; false if calls elsewhere may have to be
+  // linked differently
+  bool transplant(std::vector<Decl> &fresh, const std::unordered_set<Decl *> &claimed) {
+    std::unordered_set<const Node *> kept;
+    for (auto decl : claimed) {
+      for (auto &node : decl->nodes) {
+        each_fn(node, [&kept](auto &slot) { kept.insert(slot.get()); });
+      }
+    }
+    bool res = true;
+    for (auto &decl : fresh) {
+      for (auto &node : decl.nodes) {
+        each_fn(node, [&](auto &slot) {
+          auto &fn = static_cast<FnDeclNode &>(*slot);
+          auto old = fns.find(fn.name);
+          if (old == fns.end() || kept.contains(old->second.get())) {
+            res = false;
+            return;
+          }
+          res &= signature(fn) == signature(*old->second);
+          auto &to = *old->second;
+          to.return_type = std::move(fn.return_type);
+          to.params = std::move(fn.params);
+          to.block = std::move(fn.block);
+          slot = old->second;
+        });
+      }
+    }
+    return res;
+  }
+
+  public:
+  // the program `code` whose first line is `_line`, ready to run
+  std::shared_ptr<ScopeNode> update(std::string_view code, std::size_t _line = 1) {
+    parsed = reused = 0;
+    std::unordered_set<Decl *> claimed;
+    std::vector<Decl *> order;  // null for the fresh ones, in order
+    std::vector<Decl> fresh;
+    std::size_t at = 0, line = _line;
+    for (auto range : Parser::split(code)) {
+      line += static_cast<std::size_t>(std::count(code.begin() + static_cast<long>(at),
+                                                  code.begin() + static_cast<long>(range.first), '\n'));
+      at = range.first;
+      auto text = code.substr(range.first, range.second - range.first);
+      auto hash = std::hash<std::string_view>()(text);
+      auto decl = find(text, hash, line, claimed);
+      if (decl == nullptr) {
+        auto line_begin = code.rfind('\n', range.first);
+        auto col = range.first - (line_begin == std::string_view::npos ? 0 : line_begin + 1);
+        fresh.push_back({range.first, range.second, hash, std::string(text), line, parse(text, line, col)});
+      } else {
+        decl->begin = range.first, decl->end = range.second;
+      }
+      order.push_back(decl);
+    }
+    parsed = fresh.size();
+    reused = claimed.size();
+    std::shared_ptr<ScopeNode> res;
+    FnMap next;
+    try {
+      auto local = transplant(fresh, claimed);
+      auto block = std::make_shared<BlockNode>();
+      auto next_fresh = fresh.begin();
+      std::vector<Node *> linked;
+      for (auto decl : order) {
+        auto &nodes = decl != nullptr ? decl->nodes : (next_fresh++)->nodes;
+        for (auto &node : nodes) {
+          if (decl == nullptr) {
+            linked.push_back(node.get());
+          }
+          each_fn(node, [&](auto &slot) {
+            auto fn = std::static_pointer_cast<FnDeclNode>(slot);
+            local &= fns.contains(fn->name);
+            next[fn->name] = fn;
+          });
+        }
+        block->children.insert(block->children.end(), nodes.begin(), nodes.end());
+      }
+      // the top-level block alone is not covered by the declarations
+      block->binds = true;
+      res = std::make_shared<ScopeNode>(block);
+      if (local && next.size() == fns.size()) {
+        Linker().run(*block, linked);
+      } else {
+        Linker().run(*res);
+      }
+    } catch (...) {
+      // functions of the last version may have been rewritten already
+      cache.clear();
+      fns.clear();
+      throw;
+    }
+    // only now, as a declaration that fails to parse leaves the last version as it was
+    DeclMap next_cache;
+    for (auto decl : claimed) {
+      next_cache.emplace(decl->hash, std::move(*decl));
+    }
+    for (auto &decl : fresh) {
+      next_cache.emplace(decl.hash, std::move(decl));
+    }
+    cache = std::move(next_cache);
+    fns = std::move(next);
+    return res;
+  }
+
+  // declarations of the last update that were parsed, and that were kept from the version before
+  std::size_t parsed_count() const { return parsed; }
+  std::size_t reused_count() const { return reused; }
+};
+#endif
@@ -0,0 +1,255 @@
+#ifndef __INLINER_HPP
+#define __INLINER_HPP
+#include <map>
+#include <string>
+#include <type_traits>
+
+#include "effects.hpp"
+
+// calls of one function inlined into another; an empty caller is the top level
+struct InlineSite {
+  std::string callee, caller;
+  std::size_t calls;
+};
+
+// Replaces calls of small functions whose body is a single `return expr;` by `expr`, with each parameter replaced
+// by its argument. Names are looked up through the whole call stack at run time, so the other names in `expr`
+// resolve at the call site as they did in the callee; calls from a function declaring one of them are left alone
+// all the same, as a name bound both ways there would keep the later passes off the caller (see
+// Effects::ambiguous). A function is inlined when it cannot reach itself through
+// calls, takes no array parameters, `expr` assigns nothing and does no IO, and `expr`, with the calls in it inlined
+// first, has at most `limit` nodes. A call is inlined when its arguments are free of side effects, an argument
+// calling anything is used exactly once, one used more than once has at most `limit` nodes, and one unused is a
+// constant or a name, so that no work is repeated or dropped.
+// Runs after Linker, first thing in the Optimizer.
+class Inliner {
+  protected:
+  const EffectsAnalyzer &effects;
+  std::size_t limit;
+  std::unordered_set<const FnDeclNode *> entered;  // bodies inlined into
+  std::unordered_map<const FnDeclNode *, std::unordered_set<Symbol>> declared;  // names, by the bodies inlined into
+  std::unordered_map<const FnDeclNode *, Node *> exprs;  // of the functions that may be inlined
+  std::map<std::pair<std::string, std::string>, std::size_t> sites;  // calls inlined by callee and caller
+  std::size_t inlined = 0;
+
+  static std::size_t size(Node &node) {
+    std::size_t res = 0;
+    walk(node, [&res](Node &) {
+      res++;
+      return true;
+    });
+    return res;
+  }
+  static std::size_t uses(Node &node, Symbol var) {
+    std::size_t res = 0;
+    walk(node, [&res, var](Node &n) {
+      res += n.kind == NodeKind::VAR && static_cast<VarNode &>(n).var_name == var;
+      return true;
+    });
+    return res;
+  }
+  // without side effects: `calls` is set if it calls anything, which must then be pure
+  bool pure(Node &node, bool &calls) const {
+    bool res = true;
+    walk(node, [&](Node &n) {
+      if (n.kind == NodeKind::FN_CALL) {
+        auto &call = static_cast<FnCallNode &>(n);
+        calls = true;
+        res &= (call.fn != nullptr && effects.of(call.fn).pure()) || builtin_info(call.builtin).pure();
+      }
+      res &= n.kind != NodeKind::ASSIGN && n.kind != NodeKind::IO_IN && n.kind != NodeKind::IO_OUT;
+      return res;
+    });
+    return res;
+  }
+
+  // whether `from` reaches `to` through calls
+  static bool reaches(FnDeclNode &from, const FnDeclNode *to, std::unordered_set<const FnDeclNode *> &seen) {
+    bool res = false;
+    walk(*from.block, [&](Node &n) {
+      if (auto call = dynamic_cast<FnCallNode *>(&n); call != nullptr && call->fn != nullptr) {
+        res = res || call->fn == to || (seen.insert(call->fn).second && reaches(*call->fn, to, seen));
+      }
+      return !res;
+    });
+    return res;
+  }
+  // the returned expression of a function that may be inlined, once the calls in it are; nullptr otherwise
+  Node *expr_of(FnDeclNode &fn) {
+    if (auto it = exprs.find(&fn); it != exprs.end()) {
+      return it->second;
+    }
+    auto &res = exprs[&fn];
+    auto &body = fn.block->children;
+    auto ret = body.size() == 1 ? dynamic_cast<RetNode *>(body[0].get()) : nullptr;
+    if (ret == nullptr || ret->expr == nullptr) {
+      return nullptr;
+    }
+    bool shape = true;
+    for (auto &param : fn.params) {
+      shape &= param->dimensions.empty();
+    }
+    // builtins other than max, min and abs take names, which the arguments replacing them may not be
+    walk(*ret->expr, [&shape](Node &n) {
+      shape &= n.kind == NodeKind::BIN || n.kind == NodeKind::UNARY || n.kind == NodeKind::NUM ||
+               n.kind == NodeKind::VAR || n.kind == NodeKind::ARR_ACC || n.kind == NodeKind::CHAR ||
+               (n.kind == NodeKind::FN_CALL && (static_cast<FnCallNode &>(n).builtin == Builtin::NONE ||
+                                                builtin_info(static_cast<FnCallNode &>(n).builtin).scalar()));
+      return shape;
+    });
+    std::unordered_set<const FnDeclNode *> seen;
+    if (!shape || reaches(fn, &fn, seen)) {
+      return nullptr;
+    }
+    enter(fn);
+    if (size(*ret->expr) <= limit) {
+      res = ret->expr.get();
+    }
+    return res;
+  }
+
+  // a copy of `node` with the parameters of `fn`, if any, replaced by copies of `args`
+  static std::shared_ptr<Node> substitute(const Node &node, const FnDeclNode *fn,
+                                          const std::vector<std::shared_ptr<Node>> &args) {
+    switch (node.kind) {
+      case NodeKind::BIN: {
+        auto &bin = static_cast<const BinNode &>(node);
+        return std::make_shared<BinNode>(substitute(*bin.l, fn, args), substitute(*bin.r, fn, args), bin.op);
+      }
+      case NodeKind::UNARY: {
+        auto &un = static_cast<const UnaryNode &>(node);
+        return std::make_shared<UnaryNode>(substitute(*un.expr, fn, args), un.op);
+      }
+      case NodeKind::VAR: {
+        auto &var = static_cast<const VarNode &>(node);
+        for (std::size_t i = 0; fn != nullptr && i < fn->params.size(); ++i) {
+          if (fn->params[i]->var->var_name == var.var_name) {
+            return substitute(*args[i], nullptr, {});
+          }
+        }
+        return std::make_shared<VarNode>(var.var_name);
+      }
+      case NodeKind::ARR_ACC: {
+        auto &acc = static_cast<const ArrAccessNode &>(node);
+        auto res = std::make_shared<ArrAccessNode>(acc.name, acc.loc);
+        for (auto &i : acc.dimensions) {
+          res->dimensions.push_back(substitute(*i, fn, args));
+        }
+        return res;
+      }
+      case NodeKind::FN_CALL: {
+        auto &call = static_cast<const FnCallNode &>(node);
+        auto res = std::make_shared<FnCallNode>(call.name);
+        res->fn = call.fn;
+        res->builtin = call.builtin;
+        for (auto &i : call.call_params) {
+          res->call_params.push_back(substitute(*i, fn, args));
+        }
+        return res;
+      }
+      case NodeKind::NUM: {
+        auto res = std::make_shared<NumNode>();
+        res->value = static_cast<const NumNode &>(node).value;
+        return res;
+      }
+      case NodeKind::CHAR: {
+        auto value = static_cast<const CharNode &>(node).value;
+        return std::make_shared<CharNode>(value);
+      }
+      default:
+        return nullptr;
+    }
+  }
+
+  // whether `expr` of `fn` names one of `names` other than through a parameter
+  static bool clashes(Node &expr, const FnDeclNode &fn, const std::unordered_set<Symbol> &names) {
+    bool res = false;
+    walk(expr, [&](Node &n) {
+      if (n.kind == NodeKind::VAR) {
+        auto name = static_cast<VarNode &>(n).var_name;
+        bool param = false;
+        for (auto &i : fn.params) {
+          param |= i->var->var_name == name;
+        }
+        res |= !param && names.contains(name);
+      } else if (n.kind == NodeKind::ARR_ACC) {
+        res |= names.contains(static_cast<ArrAccessNode &>(n).name);
+      }
+      return !res;
+    });
+    return res;
+  }
+
+  // `expr` of the function `call` in `caller` is bound to, if the call can be replaced by it
+  Node *inlinable(FnCallNode &call, const FnDeclNode *caller) {
+    auto expr = call.fn != nullptr ? expr_of(*call.fn) : nullptr;
+    if (expr == nullptr) {
+      return nullptr;
+    }
+    if (caller != nullptr && clashes(*expr, *call.fn, declared[caller])) {
+      return nullptr;
+    }
+    for (std::size_t i = 0; i < call.call_params.size(); ++i) {
+      auto &arg = *call.call_params[i];
+      auto n = uses(*expr, call.fn->params[i]->var->var_name);
+      bool calls = false;
+      if (!pure(arg, calls) || (calls && n != 1) || (n > 1 && size(arg) > limit) ||
+          (n == 0 && arg.kind != NodeKind::NUM && arg.kind != NodeKind::VAR)) {
+        return nullptr;
+      }
+    }
+    return expr;
+  }
+
+  // inlines the calls in `slot` and below, innermost first
+  template <typename P>
+  void visit(P &slot, const FnDeclNode *caller) {
+    if (auto fn = dynamic_cast<FnDeclNode *>(slot.get())) {
+      enter(*fn);
+      return;
+    }
+    for_each_child(*slot, [this, caller](auto &child) { visit(child, caller); });
+    if constexpr (std::is_same_v<P, std::shared_ptr<Node>>) {
+      auto call = dynamic_cast<FnCallNode *>(slot.get());
+      auto expr = call != nullptr ? inlinable(*call, caller) : nullptr;
+      if (expr != nullptr) {
+        sites[{sym_name(call->fn->name), caller != nullptr ? sym_name(caller->name) : ""}]++;
+        inlined++;
+        slot = substitute(*expr, call->fn, call->call_params);
+      }
+    }
+  }
+  void enter(FnDeclNode &fn) {
+    if (entered.insert(&fn).second) {
+      auto &names = declared[&fn];
+      for (auto &param : fn.params) {
+        names.insert(param->var->var_name);
+      }
+      walk(*fn.block, [&names](Node &n) {
+        if (auto decl = dynamic_cast<VarDeclNode *>(&n)) {
+          names.insert(decl->var->var_name);
+        } else if (auto arr = dynamic_cast<ArrDeclNode *>(&n)) {
+          names.insert(arr->name);
+        }
+        return n.kind != NodeKind::FN_DECL;
+      });
+      visit(fn.block, &fn);
+    }
+  }
+
+  public:
+  Inliner(const EffectsAnalyzer &_effects, std::size_t _limit) : effects(_effects), limit(_limit) {}
+
+  void run(ScopeNode &root) { visit(root.block, nullptr); }
+
+  std::size_t count() const { return inlined; }
+  // by callee, then caller
+  std::vector<InlineSite> report() const {
+    std::vector<InlineSite> res;
+    for (auto &[names, calls] : sites) {
+      res.push_back({names.first, names.second, calls});
+    }
+    return res;
+  }
+};
+#endif
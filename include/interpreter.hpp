@@ -1,85 +1,317 @@
 #ifndef __INTERPRETER_HPP
 #define __INTERPRETER_HPP
+#include <algorithm>
+#include <atomic>
+#include <bit>
 #include <cassert>
+#include <climits>
+#include <cstddef>
+#include <cstring>
 #include <deque>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <unordered_map>
 #include <variant>
 #include <vector>
 
+#include <sys/mman.h>
+
+#include "builtins.hpp"
 #include "error.hpp"
+#include "governor.hpp"
+#include "kernels.hpp"
+#include "lazy.hpp"
 #include "node.hpp"
 #include "node_visitor.hpp"
-#include "utils.hpp"
+#include "policy.hpp"
+#include "pool.hpp"
+#include "recycler.hpp"
+
+// storage of interpreted arrays
+struct ArrayOptions {
+  bool packed_bools = true;  // bool arrays as a bitset, else a byte per element
+  // arrays of at least this many bytes get their own anonymous mapping, whose pages the kernel zeroes on first
+  // touch, so declaring one is O(1) and untouched parts take no memory
+  std::size_t map_threshold = 1 << 20;
+  bool huge_pages = false;  // ask for transparent huge pages on such mappings
+};
 
 class CallStack {
   public:
+  // Row-major, contiguous storage of all elements, laid out by element type: 32 bits for int, a byte for char,
+  // and a bit or a byte for bool. Stores convert like C++ does.
   class Array {
 public:
-    typedef std::variant<int, std::shared_ptr<CallStack::Array>> ArrayData;
     typedef std::size_t SizeType;
+    enum Elem : std::uint8_t {
+      INT,
+      CHAR,
+      BOOL,  // a byte per element
+      BIT,   // bool, packed
+    };
 
 protected:
-    std::vector<ArrayData> __arr;
+    // hands `bytes` bytes of storage back to the Recycler, or unmaps them
+    struct Release {
+      std::size_t bytes;
+      bool mapped;
+      void operator()(std::byte *_p) const {
+        if (mapped) {
+          munmap(_p, bytes);
+        } else {
+          Recycler::local().put(_p, bytes);
+        }
+      }
+    };
 
 public:
-    Array(SizeType _sz, const ArrayData &_val) {
-      __arr.resize(_sz);
-      if (std::holds_alternative<std::shared_ptr<CallStack::Array>>(_val)) {
-        auto value = std::get<std::shared_ptr<CallStack::Array>>(_val);
-        for (SizeType i = 0; i < _sz; ++i) {
-          __arr[i] = std::make_shared<CallStack::Array>(*value);
-        }
-      } else {
-        auto value = std::get<int>(_val);
-        for (SizeType i = 0; i < _sz; ++i) {
-          __arr[i] = value;
+    typedef std::vector<SizeType, RecyclingAllocator<SizeType>> Dims;
+
+protected:
+    Dims __dims;
+    SizeType __count;
+    Elem __elem;
+    std::unique_ptr<std::byte[], Release> __data;
+
+    // element count, saturated on overflow
+    static SizeType count(const Dims &_dims) {
+      SizeType res = 1;
+      for (auto i : _dims) {
+        if (__builtin_mul_overflow(res, i, &res)) {
+          return SIZE_MAX;
         }
       }
+      return res;
+    }
+    // bytes of storage for `_n` elements, saturated on overflow
+    static std::size_t storage(SizeType _n, Elem _elem) {
+      switch (_elem) {
+        case INT:
+          return _n > SIZE_MAX / sizeof(int) ? SIZE_MAX : _n * sizeof(int);
+        case CHAR:
+        case BOOL:
+          return _n;
+        default:
+          return (_n / 64 + (_n % 64 != 0)) * sizeof(std::uint64_t);
+      }
     }
 
-    SizeType size() const { return __arr.size(); }
+    // `_n` zeroed bytes; below the mapping threshold, a recycled block cleared at once
+    static std::unique_ptr<std::byte[], Release> allocate(std::size_t _n, const ArrayOptions &_opts) {
+      if (_n == 0 || _n < _opts.map_threshold) {
+        auto res = static_cast<std::byte *>(Recycler::local().get(_n));
+        std::memset(res, 0, _n);
+        return std::unique_ptr<std::byte[], Release>(res, Release{_n, false});
+      }
+      auto res = mmap(nullptr, _n, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+      if (res == MAP_FAILED) {
+        throw std::bad_alloc();
+      }
+#ifdef MADV_HUGEPAGE
+      if (_opts.huge_pages) {
+        // only advice: without THP support the mapping keeps small pages
+        madvise(res, _n, MADV_HUGEPAGE);
+      }
+#endif
+      return std::unique_ptr<std::byte[], Release>(static_cast<std::byte *>(res), Release{_n, true});
+    }
+
+    const std::uint64_t *words() const { return reinterpret_cast<const std::uint64_t *>(__data.get()); }
+    std::uint64_t *words() { return reinterpret_cast<std::uint64_t *>(__data.get()); }
+
+public:
+    Array(Dims _dims, Elem _elem = INT, const ArrayOptions &_opts = {})
+        : __dims(std::move(_dims)), __count(count(__dims)), __elem(_elem) {
+      auto n = storage(__count, _elem);
+      if (__count == SIZE_MAX || n == SIZE_MAX) {
+        throw std::bad_alloc();
+      }
+      __data = allocate(n, _opts);
+    }
+
+    std::size_t rank() const { return __dims.size(); }
+    SizeType size(std::size_t dim = 0) const { return __dims[dim]; }
+    Elem elem() const { return __elem; }
+    // elements of an INT array
+    int *data() { return reinterpret_cast<int *>(__data.get()); }
+    SizeType elements() const { return __count; }
+    // bytes an element takes in C++, where a bool is a byte also when it is packed here
+    std::size_t elem_size() const { return __elem == INT ? sizeof(int) : 1; }
+
+    // storage held by this array
+    std::size_t bytes() const {
+      return sizeof(Array) + __dims.capacity() * sizeof(SizeType) + storage(__count, __elem);
+    }
+    // bytes() of a new array with the given dimensions, saturated on overflow
+    static std::size_t bytes_for(const Dims &_dims, Elem _elem = INT) {
+      std::size_t res;
+      if (__builtin_add_overflow(storage(count(_dims), _elem), sizeof(Array) + _dims.size() * sizeof(SizeType),
+                                 &res)) {
+        return SIZE_MAX;
+      }
+      return res;
+    }
+
+    // by row-major offset
+    int load(SizeType idx) const {
+      switch (__elem) {
+        case INT:
+          return reinterpret_cast<const int *>(__data.get())[idx];
+        case CHAR:
+          return reinterpret_cast<const signed char *>(__data.get())[idx];
+        case BOOL:
+          return std::to_integer<int>(__data[idx]);
+        default:
+          return static_cast<int>(words()[idx / 64] >> (idx % 64) & 1);
+      }
+    }
+    // returns the value stored, converted to the element type
+    int store(SizeType idx, int value) {
+      switch (__elem) {
+        case INT:
+          return data()[idx] = value;
+        case CHAR:
+          return reinterpret_cast<signed char *>(__data.get())[idx] = static_cast<signed char>(value);
+        case BOOL:
+          __data[idx] = std::byte(value != 0);
+          return value != 0;
+        default: {
+          auto bit = std::uint64_t(1) << (idx % 64);
+          auto &word = words()[idx / 64];
+          word = value != 0 ? word | bit : word & ~bit;
+          return value != 0;
+        }
+      }
+    }
 
-    ArrayData &operator[](SizeType idx) { return __arr[idx]; }
-    const ArrayData &operator[](SizeType idx) const { return __arr[idx]; }
+    // elements [from, from + n) set to `value`, converted like store() does
+    void fill(SizeType from, SizeType n, int value) {
+      switch (__elem) {
+        case INT:
+          Kernels::fill(data() + from, n, value);
+          break;
+        case CHAR:
+          std::memset(__data.get() + from, static_cast<unsigned char>(value), n);
+          break;
+        case BOOL:
+          std::memset(__data.get() + from, value != 0, n);
+          break;
+        default:
+          for (auto i = from; i < from + n; ++i) {
+            store(i, value);
+          }
+          break;
+      }
+    }
+    // `bytes` bytes of the C++ layout set to the low byte of `value`, starting at element `from`, as memset does
+    void set_bytes(SizeType from, std::size_t bytes, int value) {
+      auto byte = static_cast<unsigned char>(value);
+      switch (__elem) {
+        case INT:
+          std::memset(__data.get() + from * sizeof(int), byte, bytes);
+          break;
+        case CHAR:
+          std::memset(__data.get() + from, byte, bytes);
+          break;
+        default:
+          fill(from, bytes, byte);
+          break;
+      }
+    }
+    // elements [from, from + n) in ascending order; see src/main.cpp for the std::sort -Wstrict-overflow false positive
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wstrict-overflow"
+    void sort(SizeType from, SizeType n) {
+      switch (__elem) {
+        case INT:
+          std::sort(data() + from, data() + from + n);
+          break;
+        case CHAR: {
+          auto first = reinterpret_cast<signed char *>(__data.get()) + from;
+          std::sort(first, first + n);
+          break;
+        }
+        case BOOL:
+          std::sort(__data.get() + from, __data.get() + from + n);
+          break;
+        default: {
+          SizeType ones = 0;
+          for (auto i = from; i < from + n; ++i) {
+            ones += static_cast<SizeType>(load(i));
+          }
+          fill(from, n - ones, 0);
+          fill(from + n - ones, ones, 1);
+          break;
+        }
+      }
+    }
+#pragma GCC diagnostic pop
   };
+  typedef std::variant<int, std::shared_ptr<Array>> CType;
 
   protected:
-  typedef std::variant<int, FnDeclNode *, std::shared_ptr<Array>> CType;
 
   class VariableMap {
-protected:
-    std::string name;
-    unsigned int level;
-
 public:
-    VariableMap(const std::string &_name, unsigned int _level) : name(_name), level(_level) {}
-    std::unordered_map<std::string, CType> __internal_map;
+    std::unordered_map<Symbol, CType, std::hash<Symbol>, std::equal_to<Symbol>,
+                       RecyclingAllocator<std::pair<const Symbol, CType>>>
+        __internal_map;
+    // bytes held by the scope and its bindings
+    std::size_t bytes = sizeof(VariableMap);
+    // bindings of arrays owned by an outer scope, whose storage is not charged here
+    std::vector<Symbol> refs;
 
-    bool has(const std::string &__idx) { return __internal_map.find(__idx) != __internal_map.end(); }
-    unsigned int get_level() { return level; }
-    CType &operator[](const std::string &__idx) { return __internal_map[__idx]; }
+    bool has(Symbol __idx) { return __internal_map.find(__idx) != __internal_map.end(); }
+    CType &operator[](Symbol __idx) { return __internal_map[__idx]; }
   };
+  // scopes [0, __depth) are live, innermost last; popped scopes stay behind, emptied, to be reused
   std::deque<VariableMap> __stack;
+  std::size_t __depth = 0;
+  std::size_t in_use = 0, peak = 0;
+
+  static std::size_t binding_bytes(const CType &_value) {
+    std::size_t res = sizeof(std::pair<const Symbol, CType>) + 2 * sizeof(void *);
+    if (auto arr = std::get_if<std::shared_ptr<Array>>(&_value)) {
+      res += (*arr)->bytes();
+    }
+    return res;
+  }
 
   public:
-  void add_scope(const std::string &_name, unsigned int _level) { __stack.push_front(VariableMap(_name, _level)); }
-  void pop_scope() {
-    assert(__stack.size() > 0);
-    __stack.pop_front();
+  static constexpr std::size_t frame_bytes = sizeof(VariableMap);
+
+  void add_scope() {
+    if (__depth == __stack.size()) {
+      __stack.emplace_back();
+    }
+    __depth++;
+    in_use += frame_bytes;
+    peak = std::max(peak, in_use);
   }
-  unsigned int top_level() {
-    if (__stack.empty()) {
-      return 0;
+  void pop_scope() {
+    assert(__depth > 0);
+    auto &scope = __stack[--__depth];
+    in_use -= scope.bytes;
+    scope.bytes = frame_bytes;
+    if (!scope.__internal_map.empty()) {
+      scope.__internal_map.clear();
+    }
+    if (!scope.refs.empty()) {
+      scope.refs.clear();
     }
-    return __stack.front().get_level();
   }
+  // bytes held by all live scopes, bindings and arrays
+  std::size_t memory() const { return in_use; }
+  std::size_t peak_memory() const { return peak; }
   template <typename T>
-  T &get(const std::string &_key) {
-    for (auto &i : __stack) {
-      if (i.has(_key)) {
-        auto &res = i[_key];
+  T &get(Symbol _key) {
+    for (auto i = __depth; i-- > 0;) {
+      auto &scope = __stack[i].__internal_map;
+      auto it = scope.find(_key);
+      if (it != scope.end()) {
+        auto &res = it->second;
         if (!std::holds_alternative<T>(res)) {
           throw std::runtime_error(get_err(ErrMsg::INV_DT_TYPE));
         }
@@ -88,63 +320,499 @@ public:
     }
     throw std::runtime_error(get_err(ErrMsg::VAR_NDEF));
   }
-  void set(std::string &_key, const CType &_value) {
-    for (auto &i : __stack) {
-      if (i.has(_key)) {
-        i[_key] = _value;
+  void set(Symbol _key, const CType &_value) {
+    for (auto i = __depth; i-- > 0;) {
+      if (__stack[i].has(_key)) {
+        __stack[i][_key] = _value;
         return;
       }
     }
     throw std::runtime_error(get_err(ErrMsg::VAR_NDEF));
   }
-  void register_var(const std::string &_key, const CType &_value) { __stack.front()[_key] = _value; }
+  // innermost binding of `_key`, nullptr if there is none
+  const CType *lookup(Symbol _key) const {
+    for (auto i = __depth; i-- > 0;) {
+      auto &scope = __stack[i].__internal_map;
+      auto it = scope.find(_key);
+      if (it != scope.end()) {
+        return &it->second;
+      }
+    }
+    return nullptr;
+  }
+  // binds a value owned by another call stack, which accounts for its memory
+  void capture(Symbol _key, const CType &_value) {
+    assert(__depth > 0);
+    __stack[__depth - 1][_key] = _value;
+  }
+  // binds an array by reference: only the binding is charged, its storage stays with the scope that declared it
+  void register_ref(Symbol _key, const std::shared_ptr<Array> &_arr) {
+    register_var(_key, 0);
+    auto &scope = __stack[__depth - 1];
+    scope.__internal_map[_key] = _arr;
+    scope.refs.push_back(_key);
+  }
+  void register_var(Symbol _key, const CType &_value) {
+    assert(__depth > 0);
+    auto &scope = __stack[__depth - 1];
+    auto [it, inserted] = scope.__internal_map.try_emplace(_key, _value);
+    std::size_t released = 0;
+    if (!inserted) {
+      released = binding_bytes(it->second);
+      if (auto ref = std::find(scope.refs.begin(), scope.refs.end(), _key); ref != scope.refs.end()) {
+        released = binding_bytes(0);
+        scope.refs.erase(ref);
+      }
+      it->second = _value;
+    }
+    auto charged = binding_bytes(_value);
+    scope.bytes = scope.bytes + charged - released;
+    in_use = in_use + charged - released;
+    peak = std::max(peak, in_use);
+  }
+};
+
+// target of an assignment or of cin: a variable, or an element of an array of any type
+struct LValue {
+  int *var;
+  CallStack::Array *arr;
+  CallStack::Array::SizeType off;
+
+  int load() const { return var != nullptr ? *var : arr->load(off); }
+  // returns the value stored, converted to the element type
+  int store(int value) { return var != nullptr ? (*var = value) : arr->store(off, value); }
+};
+
+struct ExecStats {
+  std::uint64_t ops;
+  std::chrono::milliseconds elapsed;
+  std::size_t memory, peak_memory, depth;
+  // blocks for arrays and bindings taken from the heap and from the free lists of the Recycler by the thread running
+  // the program, since it started
+  std::uint64_t heap_blocks, recycled_blocks;
 };
 
-class Interpreter : public NodeVisitor {
+// Runs the tree. The features of Policy (see DefaultPolicy) are fixed at compile time, so the default one pays for
+// no limits and no hooks.
+template <typename Policy = DefaultPolicy>
+class Interpreter final : public NodeVisitor {
   protected:
   CallStack cst;
+  Governor gov;
+  Policy hooks;
+  std::size_t depth = 0;
+  // argument values of the calls being set up, and the arrays they pass to array parameters
+  std::vector<int> args;
+  std::vector<std::shared_ptr<CallStack::Array>> ref_args;
+  // runs loops and operands marked by ParallelAnalyzer, null in the interpreters running loop iterations
+  WorkPool *pool = nullptr;
+  // forked evaluations (see ForkJoin) this one is nested in
+  std::size_t forks = 0;
+  // callee of a call in tail position whose arguments were pushed, made once the returning frame is popped
+  const FnDeclNode *tail = nullptr;
+  ArrayOptions arrays;
+  std::istream *in = &std::cin;
+  std::ostream *out = &std::cout;
+  // counts of the Recycler when the program started, leaving out the calls folded while it was optimized
+  std::uint64_t heap_base = 0, recycled_base = 0;
 
-  public:
-  NVRet vi_scope(const ScopeNode &program) {
-    cst.add_scope("__interpreter_scoped__", cst.top_level() + 1);
-    auto res = vi_block(*program.block);
+  void enter_scope() {
+    if constexpr (Policy::governed) {
+      gov.reserve(cst.memory(), CallStack::frame_bytes);
+    }
+    cst.add_scope();
+  }
+  // `n` iterations of `loop` completed
+  void back_edge(const Node &loop, std::uint64_t n = 1) {
+    if constexpr (Policy::governed) {
+      gov.tick(n);
+    }
+    if constexpr (Policy::loop_hooks) {
+      hooks.on_back_edge(loop, n);
+    }
+  }
+
+  // blocks that declare nothing (see ScopeAnalyzer) run in the enclosing scope
+  NVRet vi_scoped_block(const BlockNode &block) {
+    if (!block.binds) {
+      return vi_block(block);
+    }
+    enter_scope();
+    auto res = vi_block(block);
     cst.pop_scope();
     return res;
   }
-  NVRet vi_block(const BlockNode &block) {
-    for (auto child : block.children) {
-      auto res = child->accept(*this);
-      if (std::holds_alternative<NVRet>(res)) {
-        auto res_get = std::get<NVRet>(res);
-        if (res_get.second) {
-          return res_get;
+
+  // first element of `op` over iterations [first, last], nullptr if the access does not fit its array
+  int *idiom_row(const IdiomOperand &op, long long first, long long last) {
+    auto &arr = *cst.get<std::shared_ptr<CallStack::Array>>(op.acc->name);
+    auto rank = arr.rank();
+    if (op.acc->dimensions.size() != rank || arr.elem() != CallStack::Array::INT) {
+      return nullptr;
+    }
+    CallStack::Array::SizeType offset = 0;
+    for (std::size_t dim = 0; dim + 1 < rank; ++dim) {
+      auto idx = vi(*op.acc->dimensions[dim]);
+      if (static_cast<unsigned long>(idx) >= arr.size(dim)) {
+        return nullptr;
+      }
+      offset = offset * arr.size(dim) + static_cast<unsigned long>(idx);
+    }
+    auto size = arr.size(rank - 1);
+    if (first + op.off < 0 || last + op.off >= static_cast<long long>(size)) {
+      return nullptr;
+    }
+    return arr.data() + offset * size + static_cast<unsigned long>(first + op.off);
+  }
+  // runs a loop with a LoopIdiom as its kernel, once its init has run; false if the loop has to run instead
+  bool run_idiom(const ForLoopNode &forl) {
+    auto &idm = *forl.idiom;
+    long long first, last;
+    int *dst = nullptr, *src = nullptr, value = 0;
+    try {
+      first = cst.get<int>(idm.iv);
+      last = static_cast<long long>(vi(*idm.bound)) - (idm.inclusive ? 0 : 1);
+      if (first > last || last >= INT_MAX) {
+        return false;
+      }
+      if (idm.dst.acc != nullptr && (dst = idiom_row(idm.dst, first, last)) == nullptr) {
+        return false;
+      }
+      if (idm.src.acc != nullptr && (src = idiom_row(idm.src, first, last)) == nullptr) {
+        return false;
+      }
+      if (idm.prev.acc != nullptr && idiom_row(idm.prev, first, last) == nullptr) {
+        return false;
+      }
+      if (idm.value != nullptr) {
+        value = vi(*idm.value);
+      }
+      if (idm.acc != 0) {
+        cst.get<int>(idm.acc);
+      }
+    } catch (const std::runtime_error &) {
+      // raised again by the loop
+      return false;
+    }
+    auto n = static_cast<std::size_t>(last - first + 1);
+    back_edge(forl, n);
+    switch (idm.kind) {
+      case LoopIdiom::FILL:
+        Kernels::fill(dst, n, value);
+        break;
+      case LoopIdiom::COPY:
+        Kernels::copy(dst, src, n);
+        break;
+      case LoopIdiom::SUM:
+        cst.get<int>(idm.acc) = Kernels::sum(cst.get<int>(idm.acc), src, n);
+        break;
+      case LoopIdiom::MAX:
+        cst.get<int>(idm.acc) = Kernels::max(cst.get<int>(idm.acc), src, n);
+        break;
+      case LoopIdiom::MIN:
+        cst.get<int>(idm.acc) = Kernels::min(cst.get<int>(idm.acc), src, n);
+        break;
+      default:
+        Kernels::prefix(dst, src, n);
+        break;
+    }
+    cst.get<int>(idm.iv) = static_cast<int>(last + 1);
+    return true;
+  }
+
+  // runs iterations [lo, hi) of a parallel loop on this interpreter; its variables are `env`, shared with the
+  // interpreters running the other chunks. Iterations past `stop` are skipped.
+  void run_chunk(const ForLoopNode &forl, const std::vector<std::pair<Symbol, CallStack::CType>> &env, long long lo,
+                 long long hi, const std::atomic<long long> &stop, long long &at) {
+    auto &par = *forl.parallel;
+    cst.add_scope();
+    for (auto &[sym, value] : env) {
+      cst.capture(sym, value);
+    }
+    cst.capture(par.iv, static_cast<int>(lo));
+    auto &iv = cst.get<int>(par.iv);
+    if (forl.binds) {
+      enter_scope();
+    }
+    for (at = lo; at < hi && at <= stop.load(std::memory_order_relaxed); ++at) {
+      iv = static_cast<int>(at);
+      vi_block(*forl.body);
+      back_edge(forl);
+    }
+  }
+  // splits the iterations of a loop marked by ParallelAnalyzer into chunks, each run by its own Interpreter on the
+  // pool, once its init has run; false if the loop has to run here instead. Errors are raised as by the first
+  // failing iteration.
+  bool run_parallel(const ForLoopNode &forl) {
+    static constexpr std::uint64_t min_work = 1 << 15, chunks_per_thread = 4;
+    auto &par = *forl.parallel;
+    long long first, last;
+    try {
+      first = cst.get<int>(par.iv);
+      last = static_cast<long long>(vi(*par.bound)) - (par.inclusive ? 0 : 1);
+    } catch (const std::runtime_error &) {
+      return false;
+    }
+    if (first >= last || last >= INT_MAX || static_cast<std::uint64_t>(last - first + 1) * par.work < min_work) {
+      return false;
+    }
+    std::vector<std::pair<Symbol, CallStack::CType>> env;
+    for (auto sym : par.captures) {
+      if (auto value = cst.lookup(sym)) {
+        env.emplace_back(sym, *value);
+      }
+    }
+    // written arrays must not share storage with any other name, nor pack elements into shared words
+    for (auto sym : par.written) {
+      auto it = std::find_if(env.begin(), env.end(), [sym](const auto &i) { return i.first == sym; });
+      auto arr = it != env.end() ? std::get_if<std::shared_ptr<CallStack::Array>>(&it->second) : nullptr;
+      if (arr == nullptr || (*arr)->elem() == CallStack::Array::BIT) {
+        return false;
+      }
+      for (auto &[other, value] : env) {
+        auto other_arr = std::get_if<std::shared_ptr<CallStack::Array>>(&value);
+        if (other != sym && other_arr != nullptr && *other_arr == *arr) {
+          return false;
+        }
+      }
+    }
+
+    auto n = last - first + 1;
+    auto chunks = std::min<long long>(n, static_cast<long long>(pool->size() * chunks_per_thread));
+    auto lo = [first, n, chunks](long long k) { return first + n * k / chunks; };
+    auto limits = gov.share(cst.memory());
+    std::atomic<long long> stop = LLONG_MAX;
+    std::vector<std::uint64_t> ops(static_cast<std::size_t>(chunks));
+    std::mutex error_m;
+    std::exception_ptr error;
+    pool->run(ops.size(), [&](std::size_t c) {
+      auto k = static_cast<long long>(c), at = lo(k);
+      Interpreter worker(limits);
+      worker.arrays = arrays;
+      worker.in = in;
+      worker.out = out;
+      worker.depth = depth;
+      worker.hooks.inherit(hooks);
+      // the guards were checked here for all iterations
+      worker.loop_guards = loop_guards & forl.guard_bit;
+      try {
+        worker.run_chunk(forl, env, lo(k), lo(k + 1), stop, at);
+      } catch (...) {
+        std::lock_guard lk(error_m);
+        if (at < stop) {
+          stop = at;
+          error = std::current_exception();
         }
       }
+      ops[c] = worker.gov.ops();
+      std::lock_guard lk(error_m);
+      hooks.join(worker.hooks);
+    });
+    // only the operations up to the first failing iteration count, as if the loop had run here
+    if constexpr (Policy::governed) {
+      for (long long k = 0; k < chunks && lo(k) <= stop; ++k) {
+        gov.tick(ops[static_cast<std::size_t>(k)]);
+      }
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+    cst.get<int>(par.iv) = static_cast<int>(last + 1);
+    return true;
+  }
+
+  // evaluates the right operand of a ForkJoin on another Interpreter while this one evaluates the left one, down to
+  // a few levels of nesting. Outermost evaluations that took little time last time run here instead.
+  int fork_bin(const BinNode &bin) {
+    static constexpr std::chrono::nanoseconds min_time(1 << 15);
+    auto &fj = *bin.fork;
+    auto before = std::chrono::steady_clock::now();
+    auto took = [before] { return (std::chrono::steady_clock::now() - before).count(); };
+    if (forks == 0 && fj.last_ns.load(std::memory_order_relaxed) < min_time.count()) {
+      auto lv = vi(*bin.l), rv = vi(*bin.r);
+      fj.last_ns.store(took(), std::memory_order_relaxed);
+      return apply_bin(bin.op, lv, rv);
+    }
+    Interpreter worker(gov.share(cst.memory()));
+    worker.arrays = arrays;
+    worker.in = in;
+    worker.out = out;
+    worker.pool = pool;
+    worker.depth = depth;
+    worker.forks = forks + 1;
+    worker.hooks.inherit(hooks);
+    worker.cst.add_scope();
+    for (auto sym : fj.captures) {
+      if (auto value = cst.lookup(sym)) {
+        worker.cst.capture(sym, *value);
+      }
+    }
+    int lv = 0, rv = 0;
+    std::exception_ptr l_error, r_error;
+    forks++;
+    auto left = [&] {
+      try {
+        lv = vi(*bin.l);
+      } catch (...) {
+        l_error = std::current_exception();
+      }
+    };
+    auto right = [&] {
+      try {
+        rv = worker.vi(*bin.r);
+      } catch (...) {
+        r_error = std::current_exception();
+      }
+    };
+    // this Interpreter stays on its own thread, which the Recycler counts of --stats are taken from
+    pool->fork(left, right);
+    forks--;
+    hooks.join(worker.hooks);
+    if (l_error) {
+      std::rethrow_exception(l_error);
+    }
+    if constexpr (Policy::governed) {
+      gov.tick(worker.gov.ops());
+    }
+    if (r_error) {
+      std::rethrow_exception(r_error);
+    }
+    if (forks == 0) {
+      fj.last_ns.store(took(), std::memory_order_relaxed);
+    }
+    return apply_bin(bin.op, lv, rv);
+  }
+
+  // ForLoopNode::guard_bit of every active loop whose guards held at entry
+  std::uint64_t loop_guards = 0;
+
+  // loop preheader check: every index `iv + off` the loop can produce is inside its array
+  bool guards_hold(const ForLoopNode &forl) {
+    long long iv = cst.get<int>(forl.iv), bound = vi(*forl.bound), first, last;
+    switch (forl.bound_op) {
+      case TokenType::CMP_LES:
+        first = iv, last = bound - 1;
+        break;
+      case TokenType::CMP_LTE:
+        first = iv, last = bound;
+        break;
+      case TokenType::CMP_GRT:
+        first = bound + 1, last = iv;
+        break;
+      default:
+        first = bound, last = iv;
+        break;
+    }
+    if (first > last) {
+      return true;
+    }
+    for (auto &guard : forl.guards) {
+      auto &arr = *cst.get<std::shared_ptr<CallStack::Array>>(guard.arr);
+      if (guard.dim >= arr.rank()) {
+        return false;
+      }
+      auto size = static_cast<long long>(arr.size(guard.dim));
+      if (first + guard.min_off < 0 || last + guard.max_off >= size) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  [[noreturn]] void out_of_bounds(const ArrAccessNode &arr_access, std::size_t dim, int idx, std::size_t size) {
+    throw std::runtime_error(get_err(ErrMsg::ARR_OOB) + ": " + sym_name(arr_access.name) + "[" + std::to_string(idx) +
+                             "] (dimension " + std::to_string(dim + 1) + ", size " + std::to_string(size) +
+                             ") at line " + std::to_string(arr_access.loc.line) + ", column " +
+                             std::to_string(arr_access.loc.col));
+  }
+
+  public:
+  Interpreter(const Limits &_limits = {}) : gov(_limits) {}
+
+  void set_pool(WorkPool *_pool) { pool = _pool; }
+  void set_array_options(const ArrayOptions &_arrays) { arrays = _arrays; }
+  // what cin reads and what cout and putchar write
+  void set_streams(std::istream &_in, std::ostream &_out) {
+    in = &_in;
+    out = &_out;
+  }
+
+  // counts the blocks of stats() from here on; called once the program is loaded, before it runs
+  void count_blocks() {
+    heap_base = Recycler::local().heap_blocks();
+    recycled_base = Recycler::local().recycled_blocks();
+  }
+  Policy &policy() { return hooks; }
+  const Policy &policy() const { return hooks; }
+  ExecStats stats() const {
+    auto &blocks = Recycler::local();
+    return {gov.ops(), gov.elapsed(), cst.memory(), cst.peak_memory(), depth,
+            blocks.heap_blocks() - heap_base, blocks.recycled_blocks() - recycled_base};
+  }
+
+  NVRet vi_scope(const ScopeNode &program) { return vi_scoped_block(*program.block); }
+  NVRet vi_block(const BlockNode &block) {
+    for (auto &child : block.children) {
+      auto res = vi_stmt(*child);
+      if (res.second) {
+        return res;
+      }
     }
 
     return NVRDef;
   }
-  NVRet vi_ret(const RetNode &ret) { return NVRet(vi(*ret.expr), true); }
+  NVRet vi_ret(const RetNode &ret) {
+    if (ret.tail && depth > 0) {
+      auto &call = static_cast<const FnCallNode &>(*ret.expr);
+      push_args(call);
+      tail = call.fn;
+      return NVRet(0, true);
+    }
+    return NVRet(vi(*ret.expr), true);
+  }
   NVRet vi_for(const ForLoopNode &forl) {
     auto for_chk_expr = forl.cond;
     auto for_body = forl.body;
 
-    cst.add_scope("__interpreter_for_loop__", cst.top_level() + 1);
+    if (forl.binds) {
+      enter_scope();
+    }
 
     for (auto &i : forl.init) {
       vi(*i);
     }
+    if constexpr (Policy::bounds_checked) {
+      if (forl.guard_bit != 0) {
+        if (guards_hold(forl)) {
+          loop_guards |= forl.guard_bit;
+        } else {
+          loop_guards &= ~forl.guard_bit;
+        }
+      }
+    }
+    if ((forl.idiom && run_idiom(forl)) || (forl.parallel && pool != nullptr && run_parallel(forl))) {
+      if (forl.binds) {
+        cst.pop_scope();
+      }
+      return NVRDef;
+    }
 
     while (for_chk_expr == nullptr || vi(*for_chk_expr)) {
       auto res = vi_block(*for_body);
       if (res.second) {
+        if (forl.binds) {
+          cst.pop_scope();
+        }
         return res;
       }
       for (auto &i : forl.upd) {
         vi(*i);
       }
+      back_edge(forl);
+    }
+    if (forl.binds) {
+      cst.pop_scope();
     }
-    cst.pop_scope();
 
     return NVRDef;
   }
@@ -152,28 +820,33 @@ class Interpreter : public NodeVisitor {
     auto while_chk_expr = whilel.cond;
     auto while_body = whilel.body;
 
-    cst.add_scope("__interpreter_while_loop__", cst.top_level() + 1);
+    if (while_body->binds) {
+      enter_scope();
+    }
 
     while (vi(*while_chk_expr)) {
       auto res = vi_block(*while_body);
       if (res.second) {
+        if (while_body->binds) {
+          cst.pop_scope();
+        }
         return res;
       }
+      back_edge(whilel);
     }
 
-    cst.pop_scope();
+    if (while_body->binds) {
+      cst.pop_scope();
+    }
 
     return NVRDef;
   }
   NVRet vi_if(const IfNode &ifn) {
-    auto bl_level = cst.top_level() + 1;
     if (ifn.if_bl.first != nullptr && vi(*ifn.if_bl.first)) {
       if (ifn.if_bl.second == nullptr) {
         return NVRDef;
       }
-      cst.add_scope("__interpreter_if__", bl_level);
-      auto res = vi_block(*ifn.if_bl.second);
-      cst.pop_scope();
+      auto res = vi_scoped_block(*ifn.if_bl.second);
       if (res.second) {
         return res;
       }
@@ -184,9 +857,7 @@ class Interpreter : public NodeVisitor {
         if (elif.second == nullptr) {
           return NVRDef;
         }
-        cst.add_scope("__interpreter_elif__", bl_level);
-        auto res = vi_block(*elif.second);
-        cst.pop_scope();
+        auto res = vi_scoped_block(*elif.second);
         if (res.second) {
           return res;
         }
@@ -196,34 +867,21 @@ class Interpreter : public NodeVisitor {
     if (ifn.else_bl == nullptr) {
       return NVRDef;
     }
-    cst.add_scope("__interpreter_else__", bl_level);
-    auto res = vi_block(*ifn.else_bl);
-    cst.pop_scope();
+    auto res = vi_scoped_block(*ifn.else_bl);
     if (res.second) {
       return res;
     }
     return NVRDef;
   }
 
-  int &vi_assign(const AssignNode &assign) {
-    if (auto lv = std::dynamic_pointer_cast<VarNode>(assign.l)) {
-      auto &lv_val = vi_var(*lv);
-      auto rv = vi(*assign.r);
-      lv_val = rv;
-      return lv_val;
-    }
-    if (auto lv = std::dynamic_pointer_cast<ArrAccessNode>(assign.l)) {
-      auto &lv_val = vi_arr_acc(*lv);
-      auto rv = vi(*assign.r);
-      lv_val = rv;
-      return lv_val;
-    }
-    throw std::runtime_error(get_err(ErrMsg::INV_TOKEN));
+  int vi_assign(const AssignNode &assign) {
+    auto lv = vi_ref(*assign.l);
+    return lv.store(vi(*assign.r));
   }
   int vi_num(const NumNode &num) { return num.value; }
-  int vi_bin(const BinNode &bin) {
-    auto lv = vi(*bin.l), rv = vi(*bin.r);
-    switch (bin.op) {
+  // operator semantics, shared with constant folding
+  static int apply_bin(TokenType op, int lv, int rv) {
+    switch (op) {
       case TokenType::PLUS:
         return lv + rv;
       case TokenType::MINUS:
@@ -231,9 +889,15 @@ class Interpreter : public NodeVisitor {
       case TokenType::MUL:
         return lv * rv;
       case TokenType::DIV:
-        return lv / rv;
+        if (rv == 0) {
+          throw std::runtime_error(get_err(ErrMsg::DIV_ZERO));
+        }
+        return rv == -1 ? static_cast<int>(0u - static_cast<unsigned>(lv)) : lv / rv;
       case TokenType::MOD:
-        return lv % rv;
+        if (rv == 0) {
+          throw std::runtime_error(get_err(ErrMsg::DIV_ZERO));
+        }
+        return rv == -1 ? 0 : lv % rv;
       case TokenType::CMP_EQU:
         return lv == rv;
       case TokenType::CMP_GRT:
@@ -256,81 +920,276 @@ class Interpreter : public NodeVisitor {
         return 0;
     }
   }
-  int vi_unary(const UnaryNode &unary) {
-    switch (unary.op) {
+  static int apply_unary(TokenType op, int v) {
+    switch (op) {
       case TokenType::PLUS:
-        return +vi(*unary.expr);
+        return +v;
       case TokenType::MINUS:
-        return -vi(*unary.expr);
+        return -v;
       case TokenType::NEGATE:
-        return !vi(*unary.expr);
+        return !v;
       default:
         return 0;
     }
   }
+  int vi_bin(const BinNode &bin) {
+    if (bin.fork != nullptr && pool != nullptr && forks < std::bit_width(pool->size()) + 2) {
+      return fork_bin(bin);
+    }
+    auto lv = vi(*bin.l), rv = vi(*bin.r);
+    return apply_bin(bin.op, lv, rv);
+  }
+  int vi_unary(const UnaryNode &unary) { return apply_unary(unary.op, vi(*unary.expr)); }
 
   int &vi_var(const VarNode &var) { return cst.get<int>(var.var_name); }
   int vi_var_decl(const VarDeclNode &var_decl) {
     cst.register_var(var_decl.var->var_name, vi(*var_decl.var_value));
     return 0;
   }
-  int vi_fn_decl(FnDeclNode &fn_call) {
-    cst.register_var(fn_call.name, &fn_call);
-    return 0;
-  }
+  // calls are bound to their declarations by Linker
+  int vi_fn_decl(FnDeclNode &) { return 0; }
   int vi_fn_call(const FnCallNode &fn_call) {
-    auto &fn_name = fn_call.name;
+    const FnDeclNode *fn = fn_call.fn;
+    if (fn_call.builtin != Builtin::NONE) {
+      return vi_builtin(fn_call);
+    }
+    if (fn == nullptr) {
+      throw std::runtime_error(get_err(ErrMsg::VAR_NDEF));
+    }
+    if (fn->lazy != nullptr) [[unlikely]] {
+      LazySource::load(*fn_call.fn);
+    }
 
-    auto fn = cst.get<FnDeclNode *>(fn_name);
+    auto args_base = args.size(), refs_base = ref_args.size();
+    push_args(fn_call);
 
-    cst.add_scope(fn_name, cst.top_level() + 1);
+    // the frames a tail call replaces still count as deep: --max-depth stops runaway tail recursion all the same
+    auto outer = depth;
+    int res;
+    do {
+      ++depth;
+      if constexpr (Policy::governed) {
+        gov.tick();
+        gov.check_depth(depth);
+      }
+      enter_scope();
 
-    for (std::size_t i = 0; i < fn_call.call_params.size(); ++i) {
-      cst.register_var(fn->params[i]->var->var_name, vi(*fn_call.call_params[i]));
-    }
+      auto arg = args.begin() + static_cast<long>(args_base);
+      auto ref = ref_args.begin() + static_cast<long>(refs_base);
+      for (auto &param : fn->params) {
+        if (param->dimensions.empty()) {
+          cst.register_var(param->var->var_name, *arg++);
+        } else {
+          cst.register_ref(param->var->var_name, *ref++);
+        }
+      }
+      args.resize(args_base);
+      ref_args.resize(refs_base);
 
-    auto res = vi_block(*fn->block).first;
+      if constexpr (Policy::call_hooks) {
+        hooks.on_call(*fn);
+      }
+      res = vi_block(*fn->block).first;
+      if constexpr (Policy::call_hooks) {
+        hooks.on_return(*fn);
+      }
 
-    cst.pop_scope();
+      cst.pop_scope();
+      // a call in tail position (see vi_ret) left its arguments where this call's were
+      fn = std::exchange(tail, nullptr);
+    } while (fn != nullptr);
+    depth = outer;
 
     return res;
   }
+  // arguments are evaluated in the caller's scope before any parameter is bound
+  void push_args(const FnCallNode &fn_call) {
+    auto fn = fn_call.fn;
+    for (std::size_t i = 0; i < fn_call.call_params.size(); ++i) {
+      if (fn->params[i]->dimensions.empty()) {
+        args.push_back(vi(*fn_call.call_params[i]));
+      } else {
+        ref_args.push_back(array_arg(*fn_call.call_params[i], *fn->params[i]));
+      }
+    }
+  }
+  // the array and element offset a POINTER operand points to; its end, one past the last row, included
+  std::pair<CallStack::Array *, CallStack::Array::SizeType> pointer(const FnCallNode &call, std::size_t arg) {
+    Symbol name = 0;
+    std::shared_ptr<Node> *offset;
+    pointer_operand(call.call_params[arg], name, offset);
+    auto &arr = *cst.get<std::shared_ptr<CallStack::Array>>(name);
+    auto row = arr.size() == 0 ? 0 : arr.elements() / arr.size();
+    auto k = offset != nullptr ? vi(**offset) : 0;
+    if (k < 0 || static_cast<CallStack::Array::SizeType>(k) > arr.size()) {
+      throw std::runtime_error(get_err(ErrMsg::ARR_OOB) + ": " + sym_name(name) + " + " + std::to_string(k) + " in " +
+                               builtin_info(call.builtin).name);
+    }
+    return {&arr, static_cast<CallStack::Array::SizeType>(k) * row};
+  }
+  // elements [first, last) of an array, which fill and sort take in one dimension only
+  CallStack::Array &range(const FnCallNode &call, CallStack::Array::SizeType &first, CallStack::Array::SizeType &n) {
+    auto [arr, from] = pointer(call, 0);
+    auto to = pointer(call, 1).second;
+    if (arr->rank() != 1) {
+      throw std::runtime_error(get_err(ErrMsg::MISM_TYPE));
+    }
+    first = from;
+    n = to > from ? to - from : 0;
+    if constexpr (Policy::governed) {
+      gov.tick(n);
+    }
+    return *arr;
+  }
+  // a call bound to a builtin (see builtins.hpp), run without a frame; operands are evaluated left to right
+  int vi_builtin(const FnCallNode &call) {
+    auto &ops = call.call_params;
+    if constexpr (Policy::governed) {
+      gov.tick();
+    }
+    switch (call.builtin) {
+      case Builtin::SWAP: {
+        auto a = vi_ref(*ops[0]);
+        auto b = vi_ref(*ops[1]);
+        auto value = a.load();
+        a.store(b.load());
+        b.store(value);
+        return 0;
+      }
+      case Builtin::SIZEOF: {
+        auto value = cst.lookup(static_cast<const VarNode &>(*ops[0]).var_name);
+        if (value == nullptr) {
+          throw std::runtime_error(get_err(ErrMsg::VAR_NDEF));
+        }
+        auto arr = std::get_if<std::shared_ptr<CallStack::Array>>(value);
+        auto bytes = arr != nullptr ? (*arr)->elements() * (*arr)->elem_size() : sizeof(int);
+        return static_cast<int>(std::min<std::size_t>(bytes, INT_MAX));
+      }
+      case Builtin::MEMSET: {
+        auto [arr, from] = pointer(call, 0);
+        auto value = vi(*ops[1]);
+        auto bytes = vi(*ops[2]);
+        auto size = arr->elem_size();
+        if (bytes < 0 || static_cast<std::size_t>(bytes) > (arr->elements() - from) * size) {
+          throw std::runtime_error(get_err(ErrMsg::ARR_OOB) + ": " + std::to_string(bytes) + " bytes in memset");
+        }
+        if constexpr (Policy::governed) {
+          gov.tick(static_cast<std::uint64_t>(bytes) / size);
+        }
+        arr->set_bytes(from, static_cast<std::size_t>(bytes), value);
+        return 0;
+      }
+      case Builtin::FILL: {
+        CallStack::Array::SizeType first, n;
+        auto &arr = range(call, first, n);
+        arr.fill(first, n, vi(*ops[2]));
+        return 0;
+      }
+      case Builtin::SORT: {
+        CallStack::Array::SizeType first, n;
+        range(call, first, n).sort(first, n);
+        return 0;
+      }
+      default: {
+        auto a = vi(*ops[0]);
+        return apply_builtin(call.builtin, a, ops.size() > 1 ? vi(*ops[1]) : 0);
+      }
+    }
+  }
+  CallStack::Array::Elem elem_type(const std::string &type) const {
+    if (type == "char") {
+      return CallStack::Array::CHAR;
+    }
+    if (type == "bool") {
+      return arrays.packed_bools ? CallStack::Array::BIT : CallStack::Array::BOOL;
+    }
+    return CallStack::Array::INT;
+  }
+  // the caller's array passed to an array parameter, whose type, rank and given extents it must match
+  std::shared_ptr<CallStack::Array> array_arg(const Node &arg, const ParamsDeclNode &param) {
+    if (arg.kind != NodeKind::VAR) {
+      throw std::runtime_error(get_err(ErrMsg::INV_ARGS));
+    }
+    auto value = cst.lookup(static_cast<const VarNode &>(arg).var_name);
+    if (value == nullptr) {
+      throw std::runtime_error(get_err(ErrMsg::VAR_NDEF));
+    }
+    auto arr = std::get_if<std::shared_ptr<CallStack::Array>>(value);
+    if (arr == nullptr || (*arr)->rank() != param.dimensions.size() || (*arr)->elem() != elem_type(param.var_type)) {
+      throw std::runtime_error(get_err(ErrMsg::MISM_TYPE));
+    }
+    // like C++, the first extent is not checked
+    for (std::size_t dim = 1; dim < param.dimensions.size(); ++dim) {
+      auto extent = vi(*param.dimensions[dim]);
+      if (extent < 0 || static_cast<CallStack::Array::SizeType>(extent) != (*arr)->size(dim)) {
+        throw std::runtime_error(get_err(ErrMsg::MISM_TYPE));
+      }
+    }
+    return *arr;
+  }
   int vi_arr_decl(ArrDeclNode &arr_decl) {
     if (arr_decl.dimensions.empty()) {
       return 0;
     }
-    std::shared_ptr<CallStack::Array> arr = std::make_shared<CallStack::Array>(vi(*arr_decl.dimensions.back()), 0);
-    for (auto i = arr_decl.dimensions.rbegin() + 1; i != arr_decl.dimensions.rend(); ++i) {
-      arr = std::make_shared<CallStack::Array>(vi(**i), arr);
+    CallStack::Array::Dims dims;
+    dims.reserve(arr_decl.dimensions.size());
+    for (auto &i : arr_decl.dimensions) {
+      auto dim = vi(*i);
+      if (dim < 0) {
+        throw std::runtime_error(get_err(ErrMsg::ARR_SIZE));
+      }
+      dims.push_back(static_cast<CallStack::Array::SizeType>(dim));
+    }
+    auto elem = elem_type(arr_decl.type);
+    if constexpr (Policy::governed) {
+      gov.reserve(cst.memory(), CallStack::Array::bytes_for(dims, elem));
     }
+    // the array, its dimensions and storage all come from the Recycler, so a call declaring the arrays an earlier one
+    // did takes nothing from the heap
+    auto arr = std::allocate_shared<CallStack::Array>(RecyclingAllocator<CallStack::Array>(), std::move(dims), elem,
+                                                      arrays);
     cst.register_var(arr_decl.name, arr);
     return 0;
   }
-  int &vi_arr_acc(const ArrAccessNode &arr_access) {
-    auto arr = cst.get<std::shared_ptr<CallStack::Array>>(arr_access.name);
-    for (auto &i : arr_access.dimensions) {
-      auto &val = (*arr)[static_cast<unsigned long>(vi(*i))];
-      if (std::holds_alternative<int>(val)) {
-        return std::get<int>(val);
+  int vi_arr_acc(const ArrAccessNode &arr_access) {
+    CallStack::Array::SizeType offset;
+    auto &arr = element(arr_access, offset);
+    return arr.load(offset);
+  }
+  // array and row-major offset of an element
+  CallStack::Array &element(const ArrAccessNode &arr_access, CallStack::Array::SizeType &offset) {
+    // index expressions cannot end the scope holding the array, so the binding outlives this access
+    auto &arr = *cst.get<std::shared_ptr<CallStack::Array>>(arr_access.name);
+    if (arr_access.dimensions.size() != arr.rank()) {
+      throw std::runtime_error(get_err(ErrMsg::MISM_TYPE));
+    }
+    [[maybe_unused]] auto checked =
+        arr_access.guard_mask == 0 || (loop_guards & arr_access.guard_mask) != arr_access.guard_mask;
+    offset = 0;
+    for (std::size_t dim = 0; dim < arr.rank(); ++dim) {
+      auto idx = vi(*arr_access.dimensions[dim]);
+      if constexpr (Policy::bounds_checked) {
+        if (checked && static_cast<unsigned long>(idx) >= arr.size(dim)) {
+          out_of_bounds(arr_access, dim, idx, arr.size(dim));
+        }
       }
-      arr = std::get<std::shared_ptr<CallStack::Array>>(val);
+      offset = offset * arr.size(dim) + static_cast<unsigned long>(idx);
+    }
+    if constexpr (Policy::array_hooks) {
+      hooks.on_array(arr_access, offset);
     }
-    throw std::runtime_error(get_err(ErrMsg::MISM_TYPE));
+    return arr;
   }
 
   int vi_io_in(const IOInNode &io) {
     switch (io.type) {
       case IOType::CIN: {
         for (auto &i : io.body) {
-          if (auto i_int = std::dynamic_pointer_cast<VarNode>(i)) {
-            std::cin >> vi_var(*i_int);
-          } else if (auto i_arr = std::dynamic_pointer_cast<ArrAccessNode>(i)) {
-            std::cin >> vi_arr_acc(*i_arr);
-          } else if (auto i_assign = std::dynamic_pointer_cast<AssignNode>(i)) {
-            std::cin >> vi_assign(*i_assign);
-          } else {
-            throw std::runtime_error(get_err(ErrMsg::INV_TOKEN));
-          }
+          // read through an int, which a failed read leaves alone or zeroes like it would the element
+          auto lv = vi_ref(*i);
+          auto value = lv.load();
+          *in >> value;
+          lv.store(value);
         }
       }
       default:
@@ -346,24 +1205,22 @@ class Interpreter : public NodeVisitor {
         for (auto &i : io.body) {
           res += vi(*i);
         }
-        std::putchar(res);
+        out->put(static_cast<char>(res));
         return res;
       }
       case IOType::COUT: {
         for (auto &i : io.body) {
-          if (auto charn = std::dynamic_pointer_cast<CharNode>(i)) {
-            if (charn->value == "endl") {
-              std::cout << std::endl;
+          if (i->kind == NodeKind::CHAR) {
+            auto &char_value = static_cast<const CharNode &>(*i).value;
+            if (char_value == "endl") {
+              *out << std::endl;
+            } else if (char_value == "\\n") {
+              *out << '\n';
             } else {
-              auto &char_value = charn->value;
-              if (char_value == "\\n") {
-                std::cout << '\n';
-              } else {
-                std::cout << char_value;
-              }
+              *out << char_value;
             }
           } else {
-            std::cout << vi(*i);
+            *out << vi(*i);
           }
         }
         return 0;
@@ -374,11 +1231,82 @@ class Interpreter : public NodeVisitor {
   }
 
   int vi(Node &node) {
-    auto get_fn =
-    overloaded{[](int x) -> int { return x; }, [](const std::reference_wrapper<int> &x) -> int { return x.get(); },
-               [](const NVRet &x) -> int { return x.first; }};
-
-    return std::visit(get_fn, node.accept(*this));
+    if constexpr (Policy::node_hooks) {
+      hooks.on_node(node);
+    }
+    switch (node.kind) {
+      case NodeKind::BIN:
+        return vi_bin(static_cast<BinNode &>(node));
+      case NodeKind::UNARY:
+        return vi_unary(static_cast<UnaryNode &>(node));
+      case NodeKind::ASSIGN:
+        return vi_assign(static_cast<AssignNode &>(node));
+      case NodeKind::NUM:
+        return vi_num(static_cast<NumNode &>(node));
+      case NodeKind::VAR:
+        return vi_var(static_cast<VarNode &>(node));
+      case NodeKind::VAR_DECL:
+        return vi_var_decl(static_cast<VarDeclNode &>(node));
+      case NodeKind::FN_DECL:
+        return vi_fn_decl(static_cast<FnDeclNode &>(node));
+      case NodeKind::FN_CALL:
+        return vi_fn_call(static_cast<FnCallNode &>(node));
+      case NodeKind::ARR_DECL:
+        return vi_arr_decl(static_cast<ArrDeclNode &>(node));
+      case NodeKind::ARR_ACC:
+        return vi_arr_acc(static_cast<ArrAccessNode &>(node));
+      case NodeKind::IO_OUT:
+        return vi_io_out(static_cast<IOOutNode &>(node));
+      case NodeKind::IO_IN:
+        return vi_io_in(static_cast<IOInNode &>(node));
+      case NodeKind::BLOCK:
+      case NodeKind::SCOPE:
+      case NodeKind::FOR:
+      case NodeKind::WHILE:
+      case NodeKind::IF:
+      case NodeKind::RET:
+        return vi_stmt(node).first;
+      default:
+        return 0;
+    }
+  }
+  LValue vi_ref(Node &node) {
+    switch (node.kind) {
+      case NodeKind::VAR:
+        return {&vi_var(static_cast<VarNode &>(node)), nullptr, 0};
+      case NodeKind::ARR_ACC: {
+        LValue res{nullptr, nullptr, 0};
+        res.arr = &element(static_cast<ArrAccessNode &>(node), res.off);
+        return res;
+      }
+      case NodeKind::ASSIGN: {
+        auto &assign = static_cast<AssignNode &>(node);
+        auto res = vi_ref(*assign.l);
+        res.store(vi(*assign.r));
+        return res;
+      }
+      default:
+        throw std::runtime_error(get_err(ErrMsg::INV_TOKEN));
+    }
+  }
+  NVRet vi_stmt(Node &node) {
+    switch (node.kind) {
+      case NodeKind::BLOCK:
+        return vi_block(static_cast<BlockNode &>(node));
+      case NodeKind::SCOPE:
+        return vi_scope(static_cast<ScopeNode &>(node));
+      case NodeKind::FOR:
+        return vi_for(static_cast<ForLoopNode &>(node));
+      case NodeKind::WHILE:
+        return vi_while(static_cast<WhileLoopNode &>(node));
+      case NodeKind::IF:
+        return vi_if(static_cast<IfNode &>(node));
+      case NodeKind::RET:
+        return vi_ret(static_cast<RetNode &>(node));
+      default:
+        vi(node);
+        return NVRDef;
+    }
   }
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,64 @@
+#ifndef __KERNELS_HPP
+#define __KERNELS_HPP
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+
+// Native loops behind LoopIdiom. Each has the exact effect of running its interpreted loop over `n` elements, in
+// order, also when the operands overlap; the non-overlapping cases are written so that the compiler vectorizes
+// them. Arithmetic wraps like the interpreter's.
+class Kernels {
+  protected:
+  // whether dst[0, n) starts inside src(0, n), where a forward copy reads elements it has already written
+  static bool lags(const int *dst, const int *src, std::size_t n) {
+    return std::less<const int *>()(src, dst) && std::less<const int *>()(dst, src + n);
+  }
+
+  public:
+  static void fill(int *dst, std::size_t n, int value) { std::fill_n(dst, n, value); }
+
+  // dst[k] = src[k]
+  static void copy(int *dst, const int *src, std::size_t n) {
+    if (!lags(dst, src, n)) {
+      std::memmove(dst, src, n * sizeof(int));
+      return;
+    }
+    for (std::size_t k = 0; k < n; ++k) {
+      dst[k] = src[k];
+    }
+  }
+
+  // acc = acc + src[k]
+  static int sum(int acc, const int *__restrict src, std::size_t n) {
+    unsigned res = 0;
+    for (std::size_t k = 0; k < n; ++k) {
+      res += static_cast<unsigned>(src[k]);
+    }
+    return static_cast<int>(static_cast<unsigned>(acc) + res);
+  }
+
+  // acc = max(acc, src[k])
+  static int max(int acc, const int *__restrict src, std::size_t n) {
+    for (std::size_t k = 0; k < n; ++k) {
+      acc = std::max(acc, src[k]);
+    }
+    return acc;
+  }
+  static int min(int acc, const int *__restrict src, std::size_t n) {
+    for (std::size_t k = 0; k < n; ++k) {
+      acc = std::min(acc, src[k]);
+    }
+    return acc;
+  }
+
+  // dst[k] = dst[k - 1] + src[k]; a running sum, src is reloaded in case it overlaps dst
+  static void prefix(int *dst, const int *src, std::size_t n) {
+    auto run = static_cast<unsigned>(dst[-1]);
+    for (std::size_t k = 0; k < n; ++k) {
+      run += static_cast<unsigned>(src[k]);
+      dst[k] = static_cast<int>(run);
+    }
+  }
+};
+#endif
@@ -0,0 +1,57 @@
+#ifndef __LAZY_HPP
+#define __LAZY_HPP
+#include <memory>
+#include <string>
+
+#include "bounds.hpp"
+#include "linker.hpp"
+#include "parser.hpp"
+#include "scopes.hpp"
+
+// A program whose top-level function bodies are only matched by brace when it is parsed, and parsed the first time
+// the interpreter calls them, so that what parsing costs, in time and in memory for the tree, goes with the code that
+// runs rather than with the size of the source. A loaded body is linked against the top-level declarations and
+// analyzed as the rest of the tree was. The Optimizer does not run on such a tree, so nothing runs in parallel and
+// bodies are loaded on one thread. A syntax error in a body shows when it is first called.
+class LazySource : public std::enable_shared_from_this<LazySource> {
+  protected:
+  std::string code;
+  BlockNode *top = nullptr;
+  Linker linker;  // keeps the top-level declarations across loads
+
+  public:
+  LazySource(std::string _code) : code(std::move(_code)) {}
+
+  // the program, whose first line is `_line`
+  std::shared_ptr<ScopeNode> parse(std::size_t _line = 1) {
+    auto copy = code;
+    Lexer lexer(copy, _line);
+    auto root = Parser(lexer, shared_from_this()).parse();
+    top = root->block.get();
+    return root;
+  }
+
+  // parses the body of `fn`, padded to its column so that token locations come out as in the whole source
+  static void load(FnDeclNode &fn) {
+    auto &body = *fn.lazy;
+    auto &src = *body.source;
+    auto line_begin = src.code.rfind('\n', body.begin - 1);
+    auto col = body.begin - (line_begin == std::string::npos ? 0 : line_begin + 1);
+    auto text = std::string(col, ' ') + src.code.substr(body.begin, body.end - body.begin);
+    Lexer lexer(text, body.line);
+    Parser parser(lexer);
+    auto block = parser.parse()->block;
+    if (!parser.at_end()) {
+      throw std::runtime_error(get_err(ErrMsg::INV_TOKEN));
+    }
+    fn.block = block;
+    src.linker.run_body(*src.top, fn);
+#ifdef BOUNDCHK
+    BoundsAnalyzer().run(fn);
+#endif
+    ScopeAnalyzer().run(*fn.block);
+    // may free the source
+    fn.lazy.reset();
+  }
+};
+#endif
@@ -4,12 +4,16 @@
 #include <string>
 
 #include "error.hpp"
+#include "symbol.hpp"
 #include "token.hpp"
 
 class Lexer {
   protected:
   std::string code;
+  SymbolTable &symbols;  // identifiers are interned into
   size_t pos;
+  size_t line, line_start;
+  SourceLoc tok_loc;
   TokenType get_token_type(char c) {
     switch (c) {
       case '+':
@@ -47,6 +51,10 @@ class Lexer {
 
   void skip_whitespace() {
     while (pos < code.length() && std::isspace(code[pos])) {
+      if (code[pos] == '\n') {
+        line++;
+        line_start = pos + 1;
+      }
       pos++;
     }
   }
@@ -59,11 +67,11 @@ class Lexer {
   }
 
   Token get_identifier() {
-    std::string value;
+    auto start = pos;
     while (pos < code.length() && is_valid_var_name(code[pos], false)) {
-      value += code[pos];
       pos++;
     }
+    auto value = code.substr(start, pos - start);
     // reserved keywords
     if (value == "int" || value == "bool" || value == "char") {
       return {TokenType::VAR_TYPE, value};
@@ -92,22 +100,20 @@ class Lexer {
     if (value == "else") {
       return {TokenType::ELSE, value};
     }
-    return {TokenType::VAR, value};
+    Token token{TokenType::VAR, value};
+    token.sym = symbols.intern(token.value);
+    return token;
   }
 
   Token get_number() {
-    std::string value;
+    auto start = pos;
     while (pos < code.length() && std::isdigit(code[pos])) {
-      value += code[pos];
       pos++;
     }
-    return {TokenType::INT, value};
+    return {TokenType::INT, code.substr(start, pos - start)};
   }
 
-  public:
-  Lexer(std::string &_code) : code(std::move(_code)), pos(0) {}
-
-  Token get_next_token() {
+  Token lex_token() {
     while (pos < code.length()) {
       char cur_char = code[pos];
 
@@ -115,6 +121,7 @@ class Lexer {
         skip_whitespace();
         continue;
       }
+      tok_loc = {line, pos - line_start + 1};
 
       if (std::isdigit(cur_char)) {
         return get_number();
@@ -221,6 +228,20 @@ class Lexer {
     return {TokenType::EOF_TOKEN, ""};
   }
 
+  public:
+  // `_line` is the line number of the first line of `_code` in the original source file.
+  Lexer(std::string &_code, size_t _line = 1, SymbolTable &_symbols = SymbolTable::global())
+      : code(std::move(_code)), symbols(_symbols), pos(0), line(_line), line_start(0) {}
+
+  // of the first character after the last token
+  size_t offset() const { return pos; }
+
+  Token get_next_token() {
+    auto token = lex_token();
+    token.loc = tok_loc;
+    return token;
+  }
+
   char *peek() {
     if (pos + 1 >= code.length()) {
       return nullptr;
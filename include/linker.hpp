@@ -0,0 +1,96 @@
+#ifndef __LINKER_HPP
+#define __LINKER_HPP
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+
+#include "builtins.hpp"
+#include "error.hpp"
+#include "walker.hpp"
+
+// Binds every FnCallNode to the FnDeclNode it calls, so calls do no name lookup at run time. A call resolves to
+// the declaration in the innermost enclosing scope that declares the name, wherever in that scope it appears.
+// A call no declaration resolves is bound to the builtin of its name, if any (see builtins.hpp); other unresolved
+// calls are left unbound and fail when they are executed.
+class Linker {
+  protected:
+  typedef std::unordered_map<Symbol, FnDeclNode *> FnMap;
+  std::vector<FnMap> scopes;
+
+  // declarations binding in the scope of `block`: its children and the plain blocks nested in it
+  static void collect(BlockNode &block, FnMap &decls) {
+    for (auto &child : block.children) {
+      if (auto fn = dynamic_cast<FnDeclNode *>(child.get())) {
+        decls[fn->name] = fn;
+      } else if (auto inner = dynamic_cast<BlockNode *>(child.get())) {
+        collect(*inner, decls);
+      }
+    }
+  }
+
+  FnDeclNode *resolve(Symbol name) {
+    for (auto i = scopes.rbegin(); i != scopes.rend(); ++i) {
+      auto fn = i->find(name);
+      if (fn != i->end()) {
+        return fn->second;
+      }
+    }
+    return nullptr;
+  }
+
+  void enter(BlockNode &block) {
+    scopes.emplace_back();
+    collect(block, scopes.back());
+    visit(block);
+    scopes.pop_back();
+  }
+
+  void visit(Node &node) {
+    if (auto call = dynamic_cast<FnCallNode *>(&node)) {
+      call->fn = resolve(call->name);
+      call->builtin = call->fn == nullptr ? find_builtin(call->name) : Builtin::NONE;
+      if (call->builtin != Builtin::NONE && !builtin_operands_fit(call->builtin, call->call_params)) {
+        throw std::runtime_error(get_err(ErrMsg::INV_ARGS));
+      }
+      if (call->fn != nullptr && call->fn->params.size() != call->call_params.size()) {
+        throw std::runtime_error(get_err(ErrMsg::INV_ARGS));
+      }
+      // an array parameter is bound to an array named by the caller
+      for (std::size_t i = 0; call->fn != nullptr && i < call->call_params.size(); ++i) {
+        if (!call->fn->params[i]->dimensions.empty() && call->call_params[i]->kind != NodeKind::VAR) {
+          throw std::runtime_error(get_err(ErrMsg::INV_ARGS));
+        }
+      }
+    }
+    // blocks in BlockNode slots open a scope; plain blocks among statements do not
+    for_each_child(node, [this](auto &child) {
+      if constexpr (std::is_same_v<std::decay_t<decltype(child)>, std::shared_ptr<BlockNode>>) {
+        enter(*child);
+      } else {
+        visit(*child);
+      }
+    });
+  }
+
+  public:
+  void run(Node &root) { visit(root); }
+  // links only `nodes`, statements of the top-level block `top` (see IncrementalParser)
+  void run(BlockNode &top, const std::vector<Node *> &nodes) {
+    scopes.emplace_back();
+    collect(top, scopes.back());
+    for (auto node : nodes) {
+      visit(*node);
+    }
+    scopes.pop_back();
+  }
+  // links the body of `fn`, a top-level declaration of `top` parsed after the rest (see LazySource); the
+  // declarations of `top` are collected on the first call and kept for the next ones
+  void run_body(BlockNode &top, FnDeclNode &fn) {
+    if (scopes.empty()) {
+      scopes.emplace_back();
+      collect(top, scopes.back());
+    }
+    visit(fn);
+  }
+};
+#endif
@@ -1,120 +1,207 @@
 #ifndef __NODE_HPP
 #define __NODE_HPP
+#include <atomic>
+#include <cstdint>
 #include <memory>
+#include <optional>
 #include <vector>
 
-#include "node_visitor.hpp"
 #include "token.hpp"
 
+// concrete type of a Node, set on construction, so evaluation dispatches with a switch rather than RTTI
+enum class NodeKind : std::uint8_t {
+  BIN,
+  UNARY,
+  ASSIGN,
+  NUM,
+  VAR,
+  VAR_DECL,
+  PARAMS_DECL,
+  FN_DECL,
+  FN_CALL,
+  ARR_DECL,
+  ARR_ACC,
+  BLOCK,
+  SCOPE,
+  FOR,
+  WHILE,
+  IF,
+  RET,
+  IO_OUT,
+  IO_IN,
+  CHAR,
+};
+
+class BlockNode;
 class Node {
   public:
+  const NodeKind kind;
+  Node(NodeKind _kind) : kind(_kind) {}
   virtual ~Node() = default;
-  virtual Accept accept(NodeVisitor &) { return 0; };
 };
 
+// operands of a BinNode that may run in parallel, filled in by ParallelAnalyzer
+struct ForkJoin {
+  std::vector<Symbol> captures;  // names the right operand may look up
+  // nanoseconds the last outermost evaluation took, to leave out the ones too small to fork
+  std::atomic<std::int64_t> last_ns = INT64_MAX;
+};
 class BinNode : public Node {
   public:
   std::shared_ptr<Node> l, r;
   TokenType op;
-  BinNode() = default;
+  std::shared_ptr<ForkJoin> fork;
+  BinNode() : Node(NodeKind::BIN) {}
   BinNode(const std::shared_ptr<Node> &_l, const std::shared_ptr<Node> &_r, const TokenType &_op)
-      : l(_l), r(_r), op(_op) {}
-  Accept accept(NodeVisitor &nv) override { return nv.vi_bin(*this); }
+      : Node(NodeKind::BIN), l(_l), r(_r), op(_op) {}
 };
 class UnaryNode : public Node {
   public:
   std::shared_ptr<Node> expr;
   TokenType op;
-  UnaryNode() = default;
-  UnaryNode(const std::shared_ptr<Node> &_expr, const TokenType &_token_type) : expr(_expr), op(_token_type) {}
-  Accept accept(NodeVisitor &nv) override { return nv.vi_unary(*this); }
+  UnaryNode() : Node(NodeKind::UNARY) {}
+  UnaryNode(const std::shared_ptr<Node> &_expr, const TokenType &_token_type)
+      : Node(NodeKind::UNARY), expr(_expr), op(_token_type) {}
 };
 class AssignNode : public Node {
   public:
   std::shared_ptr<Node> l, r;
-  AssignNode() = default;
-  AssignNode(const std::shared_ptr<Node> &_l, const std::shared_ptr<Node> &_r) : l(_l), r(_r) {}
-  Accept accept(NodeVisitor &nv) override { return nv.vi_assign(*this); }
+  AssignNode() : Node(NodeKind::ASSIGN) {}
+  AssignNode(const std::shared_ptr<Node> &_l, const std::shared_ptr<Node> &_r) : Node(NodeKind::ASSIGN), l(_l), r(_r) {}
 };
 
 class NumNode : public Node {
   public:
   int value;
-  NumNode() = default;
-  NumNode(const std::string &_token_value) : value(std::stoi(_token_value)) {}
-  Accept accept(NodeVisitor &nv) override { return nv.vi_num(*this); }
+  NumNode() : Node(NodeKind::NUM) {}
+  NumNode(const std::string &_token_value) : Node(NodeKind::NUM), value(std::stoi(_token_value)) {}
 };
 
 class VarNode : public Node {
   public:
-  std::string var_name;
-  VarNode() = default;
-  VarNode(std::string &_var_name) : var_name(std::move(_var_name)) {}
-  Accept accept(NodeVisitor &nv) override { return nv.vi_var(*this); }
+  Symbol var_name;
+  VarNode() : Node(NodeKind::VAR) {}
+  VarNode(Symbol _var_name) : Node(NodeKind::VAR), var_name(_var_name) {}
 };
 class VarDeclNode : public Node {
   public:
   std::shared_ptr<VarNode> var;
   std::string var_type;
   std::shared_ptr<Node> var_value;
-  VarDeclNode() = default;
+  VarDeclNode() : Node(NodeKind::VAR_DECL) {}
   VarDeclNode(const decltype(var) &_var, decltype(var_type) &_type, const decltype(var_value) &_value)
-      : var(_var), var_type(std::move(_type)), var_value(_value) {}
-  Accept accept(NodeVisitor &nv) { return nv.vi_var_decl(*this); }
+      : Node(NodeKind::VAR_DECL), var(_var), var_type(std::move(_type)), var_value(_value) {}
 };
 
 class ParamsDeclNode : public Node {
   public:
   std::shared_ptr<VarNode> var;
   std::string var_type;
-  ParamsDeclNode() = default;
-  ParamsDeclNode(const decltype(var) &_var, decltype(var_type) &_type) : var(_var), var_type(std::move(_type)) {}
+  // extents of an array parameter, which is bound to the caller's array; null where omitted, as in `int a[]`
+  std::vector<std::shared_ptr<Node>> dimensions;
+  ParamsDeclNode() : Node(NodeKind::PARAMS_DECL) {}
+  ParamsDeclNode(const decltype(var) &_var, decltype(var_type) &_type)
+      : Node(NodeKind::PARAMS_DECL), var(_var), var_type(std::move(_type)) {}
+};
+class LazySource;
+// where the body of a function left unparsed is in its source, parsed on the first call (see LazySource)
+struct LazyBody {
+  std::shared_ptr<LazySource> source;
+  std::size_t begin, end, line;
 };
 class FnDeclNode : public Node {
   public:
-  std::string return_type, name;
+  std::string return_type;
+  Symbol name;
   std::vector<std::shared_ptr<ParamsDeclNode>> params;
-  std::shared_ptr<BlockNode> block;
-  FnDeclNode() = default;
-  FnDeclNode(decltype(return_type) &_ret_type, std::string &_name)
-      : return_type(std::move(_ret_type)), name(std::move(_name)) {}
-  Accept accept(NodeVisitor &nv) override { return nv.vi_fn_decl(*this); }
+  std::shared_ptr<BlockNode> block;  // null while `lazy` is not
+  std::unique_ptr<LazyBody> lazy;
+  FnDeclNode() : Node(NodeKind::FN_DECL) {}
+  FnDeclNode(decltype(return_type) &_ret_type, Symbol _name)
+      : Node(NodeKind::FN_DECL), return_type(std::move(_ret_type)), name(_name) {}
+};
+// library function implemented natively (see builtins.hpp)
+enum class Builtin : std::uint8_t {
+  NONE,
+  MAX,
+  MIN,
+  ABS,
+  SWAP,
+  SIZEOF,
+  MEMSET,
+  FILL,
+  SORT,
 };
 class FnCallNode : public Node {
   public:
-  std::string name;
+  Symbol name;
   std::vector<std::shared_ptr<Node>> call_params;
-  FnCallNode() = default;
-  FnCallNode(decltype(name) &_name) : name(std::move(_name)) {}
-  Accept accept(NodeVisitor &nv) override { return nv.vi_fn_call(*this); }
+  // bound by Linker: the declaration called, or else the builtin of that name
+  FnDeclNode *fn = nullptr;
+  Builtin builtin = Builtin::NONE;
+  FnCallNode() : Node(NodeKind::FN_CALL) {}
+  FnCallNode(Symbol _name) : Node(NodeKind::FN_CALL), name(_name) {}
 };
 
 class ArrDeclNode : public Node {
   public:
-  std::string type, name;
+  std::string type;
+  Symbol name;
   std::vector<std::shared_ptr<Node>> dimensions;
-  ArrDeclNode(decltype(type) &_typ, std::string &_name) : type(std::move(_typ)), name(std::move(_name)) {}
-  Accept accept(NodeVisitor &nv) override { return nv.vi_arr_decl(*this); }
+  ArrDeclNode(decltype(type) &_typ, Symbol _name) : Node(NodeKind::ARR_DECL), type(std::move(_typ)), name(_name) {}
 };
 class ArrAccessNode : public Node {
   public:
-  std::string name;
+  Symbol name;
   std::vector<std::shared_ptr<Node>> dimensions;
-  ArrAccessNode(std::string &_name) : name(std::move(_name)) {}
-  Accept accept(NodeVisitor &nv) override { return nv.vi_arr_acc(*this); }
+  SourceLoc loc;
+  // set by BoundsAnalyzer: the bounds check is skipped while every loop guard in the mask holds
+  std::uint64_t guard_mask = 0;
+  ArrAccessNode(Symbol _name, const SourceLoc &_loc = {}) : Node(NodeKind::ARR_ACC), name(_name), loc(_loc) {}
 };
 
 class BlockNode : public Node {
   public:
   std::vector<std::shared_ptr<Node>> children;
-  Accept accept(NodeVisitor &nv) override { return nv.vi_block(*this); }
+  bool binds = true;  // whether it declares anything; cleared by ScopeAnalyzer
+  BlockNode() : Node(NodeKind::BLOCK) {}
 };
 class ScopeNode : public Node {
   public:
   std::shared_ptr<BlockNode> block;
-  ScopeNode() = default;
-  ScopeNode(const decltype(block) &_block) : block(_block) {}
-  Accept accept(NodeVisitor &nv) override { return nv.vi_scope(*this); }
+  ScopeNode() : Node(NodeKind::SCOPE) {}
+  ScopeNode(const decltype(block) &_block) : Node(NodeKind::SCOPE), block(_block) {}
+};
+// Index range of one array dimension inside a counted loop: `iv + min_off` to `iv + max_off`.
+struct LoopGuard {
+  Symbol arr;
+  std::size_t dim;
+  int min_off, max_off;
+};
+// `name[e1]...[iv + off]` with loop-invariant e1...
+struct IdiomOperand {
+  const ArrAccessNode *acc = nullptr;
+  int off = 0;
+};
+// loop `for (...; iv < bound; iv = iv + 1)` with the effect of a native kernel, filled in by IdiomRecognizer
+struct LoopIdiom {
+  enum Kind { FILL, COPY, SUM, MAX, MIN, PREFIX };
+  Kind kind = FILL;
+  Symbol iv = 0;
+  std::shared_ptr<Node> bound;
+  bool inclusive = false;       // `iv <= bound`
+  Symbol acc = 0;               // scalar of SUM, MAX and MIN
+  std::shared_ptr<Node> value;  // stored by FILL
+  IdiomOperand dst, src, prev;  // PREFIX: dst = prev + src
+};
+// loop `for (...; iv < bound; iv = iv + 1)` whose iterations are independent, filled in by ParallelAnalyzer
+struct ParallelLoop {
+  Symbol iv = 0;
+  std::shared_ptr<Node> bound;
+  bool inclusive = false;        // `iv <= bound`
+  std::vector<Symbol> captures;  // names the body and its callees may look up outside the body
+  std::vector<Symbol> written;   // arrays among them the body writes
+  std::uint64_t work = 0;        // estimated interpreter steps per iteration
 };
 class ForLoopNode : public Node {
   public:
@@ -122,13 +209,24 @@ class ForLoopNode : public Node {
   std::shared_ptr<Node> cond;
   std::vector<std::shared_ptr<Node>> upd;
   std::shared_ptr<BlockNode> body;
-  Accept accept(NodeVisitor &nv) override { return nv.vi_for(*this); }
+  bool binds = true;  // whether init or body declare anything; cleared by ScopeAnalyzer
+
+  // counted loop `iv <bound_op> bound`, filled in by BoundsAnalyzer
+  Symbol iv = 0;
+  std::shared_ptr<Node> bound;
+  TokenType bound_op = TokenType::OTHERS;
+  std::uint64_t guard_bit = 0;
+  std::vector<LoopGuard> guards;
+
+  std::optional<LoopIdiom> idiom;
+  std::optional<ParallelLoop> parallel;
+  ForLoopNode() : Node(NodeKind::FOR) {}
 };
 class WhileLoopNode : public Node {
   public:
   std::shared_ptr<Node> cond;
   std::shared_ptr<BlockNode> body;
-  Accept accept(NodeVisitor &nv) override { return nv.vi_while(*this); }
+  WhileLoopNode() : Node(NodeKind::WHILE) {}
 };
 class IfNode : public Node {
   public:
@@ -137,15 +235,15 @@ class IfNode : public Node {
   IfBlock if_bl;
   std::vector<IfBlock> elif_bl;
   std::shared_ptr<BlockNode> else_bl;
-  Accept accept(NodeVisitor &nv) override { return nv.vi_if(*this); }
+  IfNode() : Node(NodeKind::IF) {}
 };
 
 class RetNode : public Node {
   public:
   std::shared_ptr<Node> expr;
-  RetNode() = default;
-  RetNode(const decltype(expr) &_exp) : expr(_exp) {}
-  Accept accept(NodeVisitor &nv) override { return nv.vi_ret(*this); }
+  bool tail = false;  // `expr` is a call made once the frame of the function is popped (see TailCallAnalyzer)
+  RetNode() : Node(NodeKind::RET) {}
+  RetNode(const decltype(expr) &_exp) : Node(NodeKind::RET), expr(_exp) {}
 };
 
 enum class IOType {
@@ -168,24 +266,22 @@ class IOOutNode : public Node {
   public:
   IOType type;
   std::vector<std::shared_ptr<Node>> body;
-  IOOutNode() = default;
-  IOOutNode(const IOType &_type) : type(_type) {}
-  Accept accept(NodeVisitor &nv) override { return nv.vi_io_out(*this); }
+  IOOutNode() : Node(NodeKind::IO_OUT) {}
+  IOOutNode(const IOType &_type) : Node(NodeKind::IO_OUT), type(_type) {}
 };
 
 class IOInNode : public Node {
   public:
   IOType type;
   std::vector<std::shared_ptr<Node>> body;
-  IOInNode() = default;
-  IOInNode(const IOType &_type) : type(_type) {}
-  Accept accept(NodeVisitor &nv) override { return nv.vi_io_in(*this); }
+  IOInNode() : Node(NodeKind::IO_IN) {}
+  IOInNode(const IOType &_type) : Node(NodeKind::IO_IN), type(_type) {}
 };
 
 class CharNode : public Node {
   public:
   std::string value;
-  CharNode() = default;
-  CharNode(std::string &_value) : value(std::move(_value)) {}
+  CharNode() : Node(NodeKind::CHAR) {}
+  CharNode(std::string &_value) : Node(NodeKind::CHAR), value(std::move(_value)) {}
 };
 #endif
\ No newline at end of file
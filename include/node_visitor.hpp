@@ -1,12 +1,13 @@
 #ifndef __NODE_VISITOR_HPP
 #define __NODE_VISITOR_HPP
 #include <utility>
-#include <variant>
 
+// result of a statement: the returned value, and whether a return was executed
 typedef std::pair<int, bool> NVRet;
 #define NVRDef NVRet(0, false);
-typedef std::variant<int, std::reference_wrapper<int>, NVRet> Accept;
 
+struct LValue;
+class Node;
 class ScopeNode;
 class BlockNode;
 class RetNode;
@@ -27,6 +28,11 @@ class IOInNode;
 class IOOutNode;
 class NodeVisitor {
   public:
+  // entry points, dispatched on Node::kind: a node evaluated as an rvalue, as an lvalue, and run as a statement
+  virtual int vi(Node &) = 0;
+  virtual LValue vi_ref(Node &) = 0;
+  virtual NVRet vi_stmt(Node &) = 0;
+
   virtual NVRet vi_scope(const ScopeNode &) = 0;
   virtual NVRet vi_block(const BlockNode &) = 0;
   virtual NVRet vi_ret(const RetNode &) = 0;
@@ -34,7 +40,7 @@ class NodeVisitor {
   virtual NVRet vi_while(const WhileLoopNode &) = 0;
   virtual NVRet vi_if(const IfNode &) = 0;
 
-  virtual int &vi_assign(const AssignNode &) = 0;
+  virtual int vi_assign(const AssignNode &) = 0;
   virtual int vi_num(const NumNode &) = 0;
   virtual int vi_bin(const BinNode &) = 0;
   virtual int vi_unary(const UnaryNode &) = 0;
@@ -42,7 +48,7 @@ class NodeVisitor {
   virtual int vi_fn_decl(FnDeclNode &) = 0;
   virtual int vi_fn_call(const FnCallNode &) = 0;
   virtual int vi_arr_decl(ArrDeclNode &) = 0;
-  virtual int &vi_arr_acc(const ArrAccessNode &) = 0;
+  virtual int vi_arr_acc(const ArrAccessNode &) = 0;
   virtual int &vi_var(const VarNode &) = 0;
   virtual int vi_var_decl(const VarDeclNode &) = 0;
 
@@ -0,0 +1,391 @@
+#ifndef __OPTIMIZER_HPP
+#define __OPTIMIZER_HPP
+#include <algorithm>
+#include <ostream>
+
+#include "folder.hpp"
+#include "idioms.hpp"
+#include "inliner.hpp"
+#include "parallel.hpp"
+#include "ssa.hpp"
+#include "tailcalls.hpp"
+
+struct OptOptions {
+  bool inline_calls = true, fold = true, copy_prop = true, licm = true, cse = true, dce = true, idioms = true;
+  bool parallel = true, tail_calls = true;
+  std::size_t inline_limit = 16;  // nodes of an inlined expression
+  std::uint64_t fold_budget = 1 << 18;  // interpreter operations for calls evaluated while folding
+  bool report = false;
+};
+
+// What each pass changed.
+struct OptReport {
+  std::size_t inlined = 0;
+  std::vector<InlineSite> inline_sites;
+  std::size_t folded = 0, folded_calls = 0;
+  std::uint64_t fold_steps = 0;
+  std::size_t copies = 0, constants = 0;
+  std::size_t hoisted = 0, loops = 0;
+  std::size_t redundant = 0, cse_temps = 0;
+  std::size_t unreachable = 0, dead_stores = 0, unused_decls = 0, pure_stmts = 0;
+  std::size_t fill_loops = 0, copy_loops = 0, sum_loops = 0, extremum_loops = 0, prefix_loops = 0;
+  std::size_t parallel_loops = 0, forks = 0;
+  std::size_t tail_calls = 0;
+  std::size_t skipped = 0;  // bodies left alone, see Effects::ambiguous
+
+  void print(std::ostream &os, const OptOptions &opts) const {
+    if (opts.inline_calls) {
+      os << "inline: " << inlined << " calls inlined\n";
+      for (auto &i : inline_sites) {
+        os << "inline: " << i.callee << " into " << (i.caller.empty() ? "<global>" : i.caller) << ", " << i.calls
+           << (i.calls == 1 ? " call\n" : " calls\n");
+      }
+    }
+    if (opts.fold) {
+      os << "fold: " << folded << " constant expressions and " << folded_calls << " calls folded in " << fold_steps
+         << " steps\n";
+    }
+    if (opts.copy_prop) {
+      os << "copy-prop: " << copies << " copies and " << constants << " constants propagated\n";
+    }
+    if (opts.licm) {
+      os << "licm: " << hoisted << " expressions hoisted out of " << loops << " loops\n";
+    }
+    if (opts.cse) {
+      os << "cse: " << redundant << " redundant expressions replaced by " << cse_temps << " temporaries\n";
+    }
+    if (opts.dce) {
+      os << "dce: " << unreachable << " unreachable statements, " << dead_stores << " dead stores, " << unused_decls
+         << " unused declarations, " << pure_stmts << " statements without effect removed\n";
+    }
+    if (opts.idioms) {
+      os << "idioms: " << fill_loops << " fill, " << copy_loops << " copy, " << sum_loops << " sum, " << extremum_loops
+         << " max/min and " << prefix_loops << " prefix-sum loops run as native kernels\n";
+    }
+    if (opts.parallel) {
+      os << "parallel: " << parallel_loops << " loops with independent iterations, " << forks
+         << " expressions with independent recursive calls\n";
+    }
+    if (opts.tail_calls) {
+      os << "tail-calls: " << tail_calls << " calls made in the frame of the returning function\n";
+    }
+    if (skipped != 0) {
+      os << "optimizer: " << skipped << " function bodies skipped (names bound ambiguously)\n";
+    }
+  }
+};
+
+// Middle end: inlining of small functions (see Inliner), partial evaluation (see PartialEvaluator), copy
+// propagation, loop-invariant code motion, common subexpression elimination and dead code elimination over the SSA
+// form of each function body (see SSAFunction), then loop idiom recognition (see IdiomRecognizer), dependence
+// analysis (see ParallelAnalyzer) and tail call detection (see TailCallAnalyzer) on the result.
+// Every pass rebuilds the SSA form of the body it rewrites. Temporaries get names the lexer cannot produce,
+// declared at the top of their function.
+// Runs after Linker and before BoundsAnalyzer and ScopeAnalyzer.
+class Optimizer {
+  protected:
+  struct Unit {
+    BlockNode &body;
+    const std::vector<std::shared_ptr<ParamsDeclNode>> &params;
+    const Effects &eff;
+  };
+
+  OptOptions opts;
+  OptReport rep;
+  EffectsAnalyzer effects;
+  std::vector<Unit> units;
+  const std::vector<std::shared_ptr<ParamsDeclNode>> no_params;
+  std::size_t temps = 0;
+  std::vector<std::shared_ptr<Node>> temp_decls;  // of the unit being rewritten
+
+  Symbol new_temp(const char *prefix) {
+    auto res = intern(std::string(prefix) + "." + std::to_string(temps++));
+    std::string type = "int";
+    temp_decls.push_back(std::make_shared<VarDeclNode>(std::make_shared<VarNode>(res), type,
+                                                       std::make_shared<NumNode>("0")));
+    return res;
+  }
+  static std::shared_ptr<Node> assign_to(Symbol var, const std::shared_ptr<Node> &value) {
+    return std::make_shared<AssignNode>(std::make_shared<VarNode>(var), value);
+  }
+  static bool is_pure(Node &node) {
+    bool res = true;
+    walk(node, [&res](Node &n) {
+      if (dynamic_cast<AssignNode *>(&n) || dynamic_cast<FnCallNode *>(&n) || dynamic_cast<IOInNode *>(&n) ||
+          dynamic_cast<IOOutNode *>(&n)) {
+        res = false;
+      }
+      return res;
+    });
+    return res;
+  }
+  static bool names_any(Node &node, const std::unordered_set<Symbol> &syms) {
+    bool res = false;
+    walk(node, [&res, &syms](Node &n) {
+      if (auto var = dynamic_cast<VarNode *>(&n)) {
+        res |= syms.contains(var->var_name);
+      } else if (auto acc = dynamic_cast<ArrAccessNode *>(&n)) {
+        res |= syms.contains(acc->name);
+      }
+      return !res;
+    });
+    return res;
+  }
+  // `var +/- num`: cheaper to recompute than to keep, and the index shape BoundsAnalyzer guards
+  static bool is_cheap(Node &node) {
+    auto bin = dynamic_cast<BinNode *>(&node);
+    if (bin == nullptr || (bin->op != TokenType::PLUS && bin->op != TokenType::MINUS)) {
+      return false;
+    }
+    return (dynamic_cast<VarNode *>(bin->l.get()) && dynamic_cast<NumNode *>(bin->r.get())) ||
+           (dynamic_cast<NumNode *>(bin->l.get()) && dynamic_cast<VarNode *>(bin->r.get()));
+  }
+  // removes a statement, keeping the side effects of `value` if it has any
+  static bool drop_stmt(std::shared_ptr<Node> &slot, const std::shared_ptr<Node> &value) {
+    if (value == nullptr || is_pure(*value)) {
+      slot = nullptr;
+      return true;
+    }
+    slot = value;
+    return false;
+  }
+
+  void copy_prop(SSAFunction &ssa) {
+    for (auto &i : ssa.copies) {
+      *i.slot = i.with;
+      (i.konst ? rep.constants : rep.copies)++;
+    }
+  }
+
+  // moves each maximal invariant expression to the preheader of the outermost loop it is invariant in: the init
+  // list of a for-loop, or just before a while-loop
+  void licm(SSAFunction &ssa) {
+    auto &occ = ssa.occurrences;
+    std::vector<bool> moved(occ.size());
+    std::map<std::pair<ValueId, int>, Symbol> temp_of;
+    std::vector<std::pair<int, std::shared_ptr<Node>>> hoists;
+    for (auto i = occ.size(); i-- > 0;) {
+      auto &o = occ[i];
+      if (o.parent >= 0 && moved[static_cast<std::size_t>(o.parent)]) {
+        moved[i] = true;
+        continue;
+      }
+      if (o.loop < 0 || !o.safe || o.size < 3) {
+        continue;
+      }
+      auto target = std::max(ssa.values[o.value].level, o.reach) + 1;
+      auto l = o.loop;
+      if (target > ssa.loops[static_cast<std::size_t>(l)].depth) {
+        continue;
+      }
+      while (ssa.loops[static_cast<std::size_t>(l)].depth != target) {
+        l = ssa.loops[static_cast<std::size_t>(l)].parent;
+      }
+      // the value is invariant, but the expression computes it from names the loop may assign before it runs
+      if (names_any(**o.slot, ssa.loops[static_cast<std::size_t>(l)].writes)) {
+        continue;
+      }
+      moved[i] = true;
+      auto [it, inserted] = temp_of.try_emplace({o.value, l}, 0);
+      if (inserted) {
+        it->second = new_temp("licm");
+        hoists.emplace_back(l, assign_to(it->second, *o.slot));
+      }
+      *o.slot = std::make_shared<VarNode>(it->second);
+      rep.hoisted++;
+    }
+    std::unordered_set<int> loops;
+    // occurrences were visited last to first
+    for (auto i = hoists.rbegin(); i != hoists.rend(); ++i) {
+      auto &loop = ssa.loops[static_cast<std::size_t>(i->first)];
+      loops.insert(i->first);
+      if (auto forl = dynamic_cast<ForLoopNode *>(loop.node)) {
+        forl->init.push_back(i->second);
+      } else {
+        auto pos = std::find_if(loop.stmts->begin(), loop.stmts->end(),
+                                [&loop](const std::shared_ptr<Node> &stmt) { return stmt.get() == loop.node; });
+        loop.stmts->insert(pos, i->second);
+      }
+    }
+    rep.loops += loops.size();
+  }
+
+  // later evaluations of a value computed on every path to them read a temporary set by the first one
+  void cse(SSAFunction &ssa) {
+    auto &occ = ssa.occurrences;
+    std::vector<bool> gone(occ.size());
+    std::unordered_map<ValueId, Symbol> temp_of;
+    std::vector<std::size_t> firsts;
+    for (auto i = occ.size(); i-- > 0;) {
+      auto &o = occ[i];
+      if (o.parent >= 0 && gone[static_cast<std::size_t>(o.parent)]) {
+        gone[i] = true;
+        continue;
+      }
+      if (o.dom < 0 || o.size < 3 || is_cheap(**o.slot)) {
+        continue;
+      }
+      gone[i] = true;
+      auto [it, inserted] = temp_of.try_emplace(o.value, 0);
+      if (inserted) {
+        it->second = new_temp("cse");
+        firsts.push_back(static_cast<std::size_t>(o.dom));
+      }
+      *o.slot = std::make_shared<VarNode>(it->second);
+      rep.redundant++;
+    }
+    for (auto i : firsts) {
+      *occ[i].slot = assign_to(temp_of[occ[i].value], *occ[i].slot);
+    }
+    rep.cse_temps += firsts.size();
+  }
+
+  void dce(SSAFunction &ssa, BlockNode &body) {
+    for (auto [list, from] : ssa.unreachable) {
+      for (auto i = from; i < list->size(); ++i) {
+        (*list)[i] = nullptr;
+        rep.unreachable++;
+      }
+    }
+    for (auto slot : ssa.pure_stmts) {
+      *slot = nullptr;
+      rep.pure_stmts++;
+    }
+    std::vector<bool> handled(ssa.defs.size());
+    for (auto &b : ssa.bindings) {
+      if (!b.local || b.used || b.decl == nullptr) {
+        continue;
+      }
+      bool removable = true;
+      for (auto d : b.defs) {
+        removable &= ssa.defs[d].stmt != nullptr;
+      }
+      if (auto arr_decl = dynamic_cast<ArrDeclNode *>(b.decl->get())) {
+        for (auto &i : arr_decl->dimensions) {
+          removable &= is_pure(*i);
+        }
+      }
+      if (!removable) {
+        continue;
+      }
+      auto decl = dynamic_cast<VarDeclNode *>(b.decl->get());
+      drop_stmt(*b.decl, decl != nullptr ? decl->var_value : nullptr);
+      for (auto d : b.defs) {
+        drop_stmt(*ssa.defs[d].stmt, static_cast<AssignNode &>(**ssa.defs[d].stmt).r);
+        handled[d] = true;
+      }
+      rep.unused_decls++;
+    }
+    for (std::size_t i = 0; i < ssa.defs.size(); ++i) {
+      auto &d = ssa.defs[i];
+      if (d.used || handled[i] || d.stmt == nullptr || !ssa.bindings[d.binding].local) {
+        continue;
+      }
+      drop_stmt(*d.stmt, static_cast<AssignNode &>(**d.stmt).r);
+      rep.dead_stores++;
+    }
+    compact(body);
+  }
+  // drops removed statements and the plain blocks left empty, innermost first
+  static void compact(Node &node) {
+    if (dynamic_cast<FnDeclNode *>(&node)) {
+      return;
+    }
+    for_each_child(node, [](auto &child) { compact(*child); });
+    auto removed = [](const std::shared_ptr<Node> &stmt) {
+      auto block = dynamic_cast<BlockNode *>(stmt.get());
+      return stmt == nullptr || (block != nullptr && block->children.empty());
+    };
+    if (auto block = dynamic_cast<BlockNode *>(&node)) {
+      std::erase_if(block->children, removed);
+    } else if (auto forl = dynamic_cast<ForLoopNode *>(&node)) {
+      std::erase_if(forl->init, removed);
+      std::erase_if(forl->upd, removed);
+    }
+  }
+
+  template <typename F>
+  void pass(F &&f) {
+    for (auto &unit : units) {
+      if (unit.eff.ambiguous || unit.eff.unknown) {
+        continue;
+      }
+      SSAFunction ssa(effects);
+      ssa.build(unit.body, unit.params);
+      temp_decls.clear();
+      f(ssa, unit.body);
+      unit.body.children.insert(unit.body.children.begin(), temp_decls.begin(), temp_decls.end());
+    }
+  }
+
+  public:
+  Optimizer(const OptOptions &_opts = {}) : opts(_opts) {}
+
+  void run(ScopeNode &root) {
+    if (opts.inline_calls) {
+      EffectsAnalyzer before;
+      before.run(root);
+      Inliner inliner(before, opts.inline_limit);
+      inliner.run(root);
+      rep.inlined = inliner.count();
+      rep.inline_sites = inliner.report();
+    }
+    effects.run(root);
+    units.push_back({*root.block, no_params, effects.of_root()});
+    walk(root, [this](Node &node) {
+      if (auto fn = dynamic_cast<FnDeclNode *>(&node)) {
+        units.push_back({*fn->block, fn->params, effects.of(fn)});
+      }
+      return true;
+    });
+    for (auto &unit : units) {
+      rep.skipped += unit.eff.ambiguous || unit.eff.unknown;
+    }
+    PartialEvaluator folder(effects, opts.fold_budget);
+    if (opts.fold) {
+      folder.fold(root);
+    }
+    if (opts.copy_prop) {
+      pass([this](SSAFunction &ssa, BlockNode &) { copy_prop(ssa); });
+      // propagated constants make more expressions constant
+      if (opts.fold) {
+        folder.fold(root);
+      }
+    }
+    rep.folded = folder.exprs;
+    rep.folded_calls = folder.calls;
+    rep.fold_steps = folder.steps;
+    if (opts.licm) {
+      pass([this](SSAFunction &ssa, BlockNode &) { licm(ssa); });
+    }
+    if (opts.cse) {
+      pass([this](SSAFunction &ssa, BlockNode &) { cse(ssa); });
+    }
+    if (opts.dce) {
+      pass([this](SSAFunction &ssa, BlockNode &body) { dce(ssa, body); });
+    }
+    if (opts.idioms) {
+      IdiomRecognizer idioms;
+      idioms.run(root);
+      rep.fill_loops = idioms.count(LoopIdiom::FILL);
+      rep.copy_loops = idioms.count(LoopIdiom::COPY);
+      rep.sum_loops = idioms.count(LoopIdiom::SUM);
+      rep.extremum_loops = idioms.count(LoopIdiom::MAX) + idioms.count(LoopIdiom::MIN);
+      rep.prefix_loops = idioms.count(LoopIdiom::PREFIX);
+    }
+    if (opts.parallel) {
+      ParallelAnalyzer parallel;
+      parallel.run(root);
+      rep.parallel_loops = parallel.count();
+      rep.forks = parallel.fork_count();
+    }
+    if (opts.tail_calls) {
+      TailCallAnalyzer tails;
+      tails.run(root);
+      rep.tail_calls = tails.count();
+    }
+  }
+
+  const OptReport &report() const { return rep; }
+};
+#endif
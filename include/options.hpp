@@ -0,0 +1,135 @@
+#ifndef __OPTIONS_HPP
+#define __OPTIONS_HPP
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "governor.hpp"
+#include "optimizer.hpp"
+
+struct Options {
+  std::string source = "source-code.cpp";
+  std::vector<std::string> sources;  // every source given, for --green
+  Limits limits;
+  OptOptions opt;
+  ArrayOptions arrays;
+  std::size_t threads = 0;  // for parsing and parallel loops, 0: one per core
+  bool stats = false;
+  bool profile = false;
+  bool counters = false;
+  bool watch = false;
+  bool lazy = false;
+  bool green = false;
+  std::uint64_t slice = 1000;                       // microseconds a --green job runs before the others get a turn
+  std::size_t green_stack = std::size_t(1) << 20;  // bytes of stack of each --green job
+};
+
+// parses a non-negative integer with an optional K/M/G (binary) suffix
+inline std::uint64_t parse_size(std::string_view _opt, std::string_view _value) {
+  std::size_t len = 0;
+  std::uint64_t res = 0;
+  try {
+    res = std::stoull(std::string(_value), &len);
+  } catch (const std::logic_error &) {
+    throw std::invalid_argument("Invalid value for option " + std::string(_opt));
+  }
+  if (len + 1 == _value.size()) {
+    switch (_value.back()) {
+      case 'K':
+      case 'k':
+        return res << 10;
+      case 'M':
+      case 'm':
+        return res << 20;
+      case 'G':
+      case 'g':
+        return res << 30;
+      default:
+        break;
+    }
+  }
+  if (len != _value.size()) {
+    throw std::invalid_argument("Invalid value for option " + std::string(_opt));
+  }
+  return res;
+}
+
+inline Options parse_options(int argc, char **argv) {
+  Options res;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    if (!arg.starts_with("--")) {
+      res.source = arg;
+      res.sources.emplace_back(arg);
+      continue;
+    }
+    auto eq = arg.find('=');
+    auto opt = arg.substr(0, eq);
+    auto value = eq == std::string_view::npos ? std::string_view() : arg.substr(eq + 1);
+    if (opt == "--max-ops") {
+      res.limits.max_ops = parse_size(opt, value);
+    } else if (opt == "--time-limit") {
+      res.limits.time_limit = std::chrono::milliseconds(parse_size(opt, value));
+    } else if (opt == "--max-memory") {
+      res.limits.max_memory = parse_size(opt, value);
+    } else if (opt == "--max-depth") {
+      res.limits.max_depth = parse_size(opt, value);
+    } else if (opt == "--stats") {
+      res.stats = true;
+    } else if (opt == "--profile") {
+      res.profile = true;
+    } else if (opt == "--counters") {
+      res.counters = true;
+    } else if (opt == "--watch") {
+      res.watch = true;
+    } else if (opt == "--lazy") {
+      res.lazy = true;
+    } else if (opt == "--green") {
+      res.green = true;
+    } else if (opt == "--slice") {
+      res.slice = parse_size(opt, value);
+    } else if (opt == "--green-stack") {
+      res.green_stack = parse_size(opt, value);
+    } else if (opt == "--no-opt") {
+      res.opt.inline_calls = res.opt.fold = res.opt.copy_prop = res.opt.licm = res.opt.cse = res.opt.dce = false;
+      res.opt.idioms = res.opt.parallel = res.opt.tail_calls = false;
+    } else if (opt == "--no-inline") {
+      res.opt.inline_calls = false;
+    } else if (opt == "--inline-limit") {
+      res.opt.inline_limit = parse_size(opt, value);
+    } else if (opt == "--no-fold") {
+      res.opt.fold = false;
+    } else if (opt == "--fold-budget") {
+      res.opt.fold_budget = parse_size(opt, value);
+    } else if (opt == "--no-copy-prop") {
+      res.opt.copy_prop = false;
+    } else if (opt == "--no-licm") {
+      res.opt.licm = false;
+    } else if (opt == "--no-cse") {
+      res.opt.cse = false;
+    } else if (opt == "--no-dce") {
+      res.opt.dce = false;
+    } else if (opt == "--no-idioms") {
+      res.opt.idioms = false;
+    } else if (opt == "--no-parallel") {
+      res.opt.parallel = false;
+    } else if (opt == "--no-tail-calls") {
+      res.opt.tail_calls = false;
+    } else if (opt == "--byte-bools") {
+      res.arrays.packed_bools = false;
+    } else if (opt == "--map-threshold") {
+      res.arrays.map_threshold = parse_size(opt, value);
+    } else if (opt == "--huge-pages") {
+      res.arrays.huge_pages = true;
+    } else if (opt == "--threads") {
+      res.threads = parse_size(opt, value);
+    } else if (opt == "--opt-report") {
+      res.opt.report = true;
+    } else {
+      throw std::invalid_argument("Unknown option " + std::string(arg));
+    }
+  }
+  return res;
+}
+#endif
@@ -0,0 +1,193 @@
+#ifndef __PARALLEL_HPP
+#define __PARALLEL_HPP
+#include <set>
+
+#include "bounds.hpp"
+#include "effects.hpp"
+
+// Dependence analysis for automatic parallelization. The iterations of a loop `for (...; iv < bound; iv = iv + 1)`
+// are independent when its body does no I/O and does not return, calls only functions without side effects,
+// declares every scalar it assigns, and indexes every array it writes by the same `iv + c` in the same dimension
+// wherever it touches that array, which its callees do not read. The interpreter then splits the iterations into
+// chunks, each run by its own Interpreter on the WorkPool. Only the outermost such loop of a nest is marked.
+// Likewise the two operands of `f(...) op g(...)` are evaluated in parallel when both calls are free of side effects
+// and one of them is recursive, as in divide and conquer. Builtins count as functions, with their own effects (see
+// builtins.hpp).
+class ParallelAnalyzer {
+  protected:
+  static constexpr std::uint64_t repeat = 16;  // assumed trips of inner loops, and steps of a call
+  static constexpr std::uint64_t max_work = 1 << 20;
+
+  EffectsAnalyzer effects;
+  std::size_t loops = 0, forks = 0;
+
+  static std::uint64_t weight(Node &node) {
+    std::uint64_t res = 1;
+    for_each_child(node, [&res](auto &child) { res += weight(*child); });
+    if (dynamic_cast<ForLoopNode *>(&node) || dynamic_cast<WhileLoopNode *>(&node) ||
+        dynamic_cast<FnCallNode *>(&node)) {
+      res *= repeat;
+    }
+    return std::min(res, max_work);
+  }
+
+  // (dimension, offset) pairs at which `acc` is indexed by `iv + offset`
+  static std::set<std::pair<std::size_t, int>> iv_indices(const ArrAccessNode &acc, Symbol iv) {
+    std::set<std::pair<std::size_t, int>> res;
+    for (std::size_t dim = 0; dim < acc.dimensions.size(); ++dim) {
+      int off;
+      if (BoundsAnalyzer::index_offset(acc.dimensions[dim], iv, off)) {
+        res.emplace(dim, off);
+      }
+    }
+    return res;
+  }
+
+  // whether every write of the body lands on elements no other iteration touches
+  static bool disjoint(BlockNode &body, Symbol iv, const Effects &eff) {
+    bool res = true;
+    std::unordered_map<Symbol, std::set<std::pair<std::size_t, int>>> common;
+    walk(body, [&](Node &node) {
+      if (dynamic_cast<RetNode *>(&node) || dynamic_cast<FnDeclNode *>(&node)) {
+        res = false;
+      } else if (auto var = dynamic_cast<VarNode *>(&node)) {
+        res &= !eff.writes.contains(var->var_name);
+      } else if (auto decl = dynamic_cast<VarDeclNode *>(&node)) {
+        res &= decl->var->var_name != iv;
+      } else if (auto arr_decl = dynamic_cast<ArrDeclNode *>(&node)) {
+        res &= arr_decl->name != iv;
+      } else if (auto acc = dynamic_cast<ArrAccessNode *>(&node); acc != nullptr && eff.writes.contains(acc->name)) {
+        auto here = iv_indices(*acc, iv);
+        auto [it, inserted] = common.try_emplace(acc->name, here);
+        if (!inserted) {
+          std::erase_if(it->second, [&here](const auto &i) { return !here.contains(i); });
+        }
+        res &= !it->second.empty();
+      }
+      return res;
+    });
+    return res;
+  }
+
+  bool recursive(const FnDeclNode *fn) const {
+    std::unordered_set<const FnDeclNode *> seen;
+    std::vector<const FnDeclNode *> todo = {fn};
+    while (!todo.empty()) {
+      auto cur = todo.back();
+      todo.pop_back();
+      for (auto callee : effects.of(cur).callees) {
+        if (callee == fn) {
+          return true;
+        }
+        if (seen.insert(callee).second) {
+          todo.push_back(callee);
+        }
+      }
+    }
+    return false;
+  }
+  // a call of a function without side effects, with arguments that have none either; adds the names evaluating it
+  // may look up to `captures`
+  bool pure_call(Node &node, std::unordered_set<Symbol> &captures) const {
+    auto call = dynamic_cast<FnCallNode *>(&node);
+    if (call == nullptr || call->fn == nullptr) {
+      return false;
+    }
+    bool res = true;
+    auto add = [&](Node &n) {
+      if (auto inner = dynamic_cast<FnCallNode *>(&n)) {
+        auto eff = inner->fn != nullptr ? &effects.of(inner->fn) : nullptr;
+        res &= (eff != nullptr && eff->pure() && !eff->ambiguous) || builtin_info(inner->builtin).pure();
+        if (res && eff != nullptr) {
+          captures.insert(eff->reads.begin(), eff->reads.end());
+        }
+      } else if (auto var = dynamic_cast<VarNode *>(&n)) {
+        captures.insert(var->var_name);
+      } else if (auto acc = dynamic_cast<ArrAccessNode *>(&n)) {
+        captures.insert(acc->name);
+      } else if (dynamic_cast<AssignNode *>(&n) || dynamic_cast<IOInNode *>(&n) || dynamic_cast<IOOutNode *>(&n)) {
+        res = false;
+      }
+      return res;
+    };
+    walk(node, add);
+    return res;
+  }
+  // `f(...) op g(...)` where both calls are pure and at least one of them recursive: divide and conquer
+  void match(BinNode &bin) {
+    std::unordered_set<Symbol> left, right;
+    if (!pure_call(*bin.l, left) || !pure_call(*bin.r, right) ||
+        (!recursive(static_cast<FnCallNode &>(*bin.l).fn) && !recursive(static_cast<FnCallNode &>(*bin.r).fn))) {
+      return;
+    }
+    bin.fork = std::make_shared<ForkJoin>();
+    bin.fork->captures.assign(right.begin(), right.end());
+    forks++;
+  }
+
+  void match(ForLoopNode &forl) {
+    auto cond = dynamic_cast<BinNode *>(forl.cond.get());
+    if (forl.idiom || cond == nullptr || (cond->op != TokenType::CMP_LES && cond->op != TokenType::CMP_LTE) ||
+        forl.upd.size() != 1) {
+      return;
+    }
+    auto iv = dynamic_cast<VarNode *>(cond->l.get());
+    int step;
+    if (iv == nullptr || !BoundsAnalyzer::loop_step(forl.upd[0], iv->var_name, step) || step != 1) {
+      return;
+    }
+    auto eff = EffectsAnalyzer::of_block(*forl.body);
+    if (eff.io || eff.unknown || eff.ambiguous || eff.writes.contains(iv->var_name) ||
+        !disjoint(*forl.body, iv->var_name, eff)) {
+      return;
+    }
+    ParallelLoop par;
+    std::unordered_set<Symbol> captures(eff.reads.begin(), eff.reads.end());
+    captures.insert(eff.writes.begin(), eff.writes.end());
+    for (auto callee : eff.callees) {
+      auto &sub = effects.of(callee);
+      if (!sub.pure() || sub.ambiguous) {
+        return;
+      }
+      for (auto sym : sub.reads) {
+        if (eff.writes.contains(sym)) {
+          return;
+        }
+        captures.insert(sym);
+      }
+    }
+    BoundsAnalyzer::Writes w;
+    w.names = eff.writes;
+    w.names.insert(iv->var_name);
+    if (!BoundsAnalyzer::is_invariant(*cond->r, w)) {
+      return;
+    }
+    par.iv = iv->var_name;
+    par.bound = cond->r;
+    par.inclusive = cond->op == TokenType::CMP_LTE;
+    par.captures.assign(captures.begin(), captures.end());
+    par.written.assign(eff.writes.begin(), eff.writes.end());
+    par.work = weight(*forl.body);
+    forl.parallel = std::move(par);
+    loops++;
+  }
+
+  public:
+  void run(ScopeNode &root) {
+    effects.run(root);
+    walk(root, [this](Node &node) {
+      if (auto forl = dynamic_cast<ForLoopNode *>(&node)) {
+        match(*forl);
+        return !forl->parallel;
+      }
+      if (auto bin = dynamic_cast<BinNode *>(&node)) {
+        match(*bin);
+      }
+      return true;
+    });
+  }
+
+  std::size_t count() const { return loops; }
+  std::size_t fork_count() const { return forks; }
+};
+#endif
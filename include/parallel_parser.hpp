@@ -0,0 +1,167 @@
+#ifndef __PARALLEL_PARSER_HPP
+#define __PARALLEL_PARSER_HPP
+#include <deque>
+#include <iterator>
+#include <string_view>
+
+#include "parser.hpp"
+#include "pool.hpp"
+#include "walker.hpp"
+
+// Parses a source on a WorkPool. Each top-level function declaration (see Parser::split), and each run of other
+// statements between two of them, is a piece lexed and parsed on its own, into a SymbolTable of its own, so that the
+// workers share nothing. The pieces are then joined in source order and their symbols renumbered into the global
+// table in order of first appearance, as the Parser numbers them: the tree is the one Parser builds, ids included.
+// A source that does not split into pieces that each parse to the end is parsed again by Parser, which then fails
+// or stops early as it does on its own.
+class ParallelParser {
+  protected:
+  struct Piece {
+    std::size_t begin, end, line;
+    SymbolTable symbols;
+    std::vector<Symbol> ids;  // of `symbols` in the global table
+    std::vector<std::shared_ptr<Node>> nodes;
+    bool parsed = false;
+  };
+
+  WorkPool *pool;
+
+  // whether `text` is `type name(...) {...}`, going by its first tokens
+  static bool is_fn(std::string_view text) {
+    std::size_t i = 0;
+    auto word = [&text, &i] {
+      auto from = i;
+      while (i < text.size() && (std::isalnum(static_cast<unsigned char>(text[i])) || text[i] == '_')) {
+        i++;
+      }
+      auto res = text.substr(from, i - from);
+      while (i < text.size() && std::isspace(static_cast<unsigned char>(text[i]))) {
+        i++;
+      }
+      return res;
+    };
+    auto type = word();
+    if (type != "int" && type != "bool" && type != "char") {
+      return false;
+    }
+    auto name = word();
+    return !name.empty() && !std::isdigit(static_cast<unsigned char>(name[0])) && i < text.size() &&
+           text[i] == '(' && text.back() == '}';
+  }
+
+  // a piece of `code`, padded to its column so that token locations come out as in the whole source; left
+  // unparsed on a syntax error or on tokens left over
+  static void parse(std::string_view code, Piece &piece) {
+    auto line_begin = code.rfind('\n', piece.begin);
+    auto col = piece.begin - (line_begin == std::string_view::npos ? 0 : line_begin + 1);
+    auto padded = std::string(col, ' ') + std::string(code.substr(piece.begin, piece.end - piece.begin));
+    try {
+      Lexer lexer(padded, piece.line, piece.symbols);
+      Parser parser(lexer);
+      auto root = parser.parse();
+      if (parser.at_end()) {
+        piece.nodes = std::move(root->block->children);
+        piece.parsed = true;
+      }
+    } catch (const std::exception &) {
+    }
+  }
+
+  // maps the symbols of a piece through `ids`; declared names are not children (see for_each_child)
+  static void renumber(Node &root, const std::vector<Symbol> &ids) {
+    walk(root, [&ids](Node &node) {
+      switch (node.kind) {
+        case NodeKind::VAR: {
+          auto &var = static_cast<VarNode &>(node);
+          var.var_name = ids[var.var_name];
+          break;
+        }
+        case NodeKind::VAR_DECL:
+          renumber(*static_cast<VarDeclNode &>(node).var, ids);
+          break;
+        case NodeKind::FN_DECL: {
+          auto &fn = static_cast<FnDeclNode &>(node);
+          fn.name = ids[fn.name];
+          for (auto &param : fn.params) {
+            renumber(*param->var, ids);
+            for (auto &i : param->dimensions) {
+              if (i != nullptr) {
+                renumber(*i, ids);
+              }
+            }
+          }
+          break;
+        }
+        case NodeKind::FN_CALL: {
+          auto &call = static_cast<FnCallNode &>(node);
+          call.name = ids[call.name];
+          break;
+        }
+        case NodeKind::ARR_DECL: {
+          auto &arr = static_cast<ArrDeclNode &>(node);
+          arr.name = ids[arr.name];
+          break;
+        }
+        case NodeKind::ARR_ACC: {
+          auto &acc = static_cast<ArrAccessNode &>(node);
+          acc.name = ids[acc.name];
+          break;
+        }
+        default:
+          break;
+      }
+      return true;
+    });
+  }
+
+  public:
+  ParallelParser(WorkPool *_pool) : pool(_pool) {}
+
+  // the program `code` whose first line is `_line`; takes `code` like Lexer does
+  std::shared_ptr<ScopeNode> parse(std::string &code, std::size_t _line = 1) {
+    std::deque<Piece> pieces;
+    bool in_fn = true;  // whether the last piece is a function
+    std::size_t at = 0, line = _line;
+    for (auto [begin, end] : Parser::split(code)) {
+      auto fn = is_fn(std::string_view(code).substr(begin, end - begin));
+      if (fn || in_fn) {
+        auto gap = std::count(code.begin() + static_cast<long>(at), code.begin() + static_cast<long>(begin), '\n');
+        line += static_cast<std::size_t>(gap);
+        at = begin;
+        auto &piece = pieces.emplace_back();
+        piece.begin = begin;
+        piece.line = line;
+      }
+      pieces.back().end = end;
+      in_fn = fn;
+    }
+    bool parsed = pool != nullptr && pieces.size() > 1;
+    if (parsed) {
+      pool->run(pieces.size(), [&](std::size_t i) { parse(code, pieces[i]); });
+      for (auto &piece : pieces) {
+        parsed &= piece.parsed;
+      }
+    }
+    if (!parsed) {
+      Lexer lexer(code, _line);
+      return Parser(lexer).parse();
+    }
+    // interning is in order, the renumbering of each piece on its own
+    for (auto &piece : pieces) {
+      for (Symbol i = 0; i < piece.symbols.size(); ++i) {
+        piece.ids.push_back(intern(piece.symbols.name(i)));
+      }
+    }
+    pool->run(pieces.size(), [&pieces](std::size_t i) {
+      for (auto &node : pieces[i].nodes) {
+        renumber(*node, pieces[i].ids);
+      }
+    });
+    auto block = std::make_shared<BlockNode>();
+    for (auto &piece : pieces) {
+      std::move(piece.nodes.begin(), piece.nodes.end(), std::back_inserter(block->children));
+    }
+    return std::make_shared<ScopeNode>(block);
+  }
+};
+#endif
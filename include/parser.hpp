@@ -1,6 +1,10 @@
 #ifndef __PARSER_HPP
 #define __PARSER_HPP
+#include <algorithm>
+#include <cctype>
 #include <memory>
+#include <string_view>
+#include <vector>
 
 #include "lexer.hpp"
 #include "node.hpp"
@@ -9,6 +13,9 @@ class Parser {
   protected:
   Lexer &lexer;
   Token cur_token;
+  // the source of top-level function bodies left unparsed, null to parse them all
+  std::shared_ptr<LazySource> lazy;
+  std::size_t open_blocks = 0;
   bool eat(const TokenType &token_type, bool safe = false) {
     if (cur_token.type == token_type) {
       cur_token = lexer.get_next_token();
@@ -22,6 +29,7 @@ class Parser {
   std::shared_ptr<ScopeNode> scoped() { return std::make_shared<ScopeNode>(block()); }
   std::shared_ptr<BlockNode> block(bool single_statement = false) {
     auto res = std::make_shared<BlockNode>();
+    open_blocks++;
     if (single_statement) {
       bool should_eat_token = true;
       res->children.push_back(stment(true, true, should_eat_token));
@@ -31,10 +39,11 @@ class Parser {
     } else {
       stments(res->children, TokenType::SEMI, true, true);
     }
+    open_blocks--;
     return res;
   }
 
-  std::shared_ptr<Node> var_decl(std::string &name, std::string &type) {
+  std::shared_ptr<Node> var_decl(Symbol name, std::string &type) {
     if (cur_token.type == TokenType::BRKET_OPEN) {
       auto arr_node = std::make_shared<ArrDeclNode>(type, name);
       while (true) {
@@ -54,13 +63,14 @@ class Parser {
     return std::make_shared<VarDeclNode>(std::make_shared<VarNode>(name), type, std::make_shared<NumNode>("0"));
   }
   std::shared_ptr<VarNode> var() {
-    auto node = std::make_shared<VarNode>(cur_token.value);
+    auto node = std::make_shared<VarNode>(cur_token.sym);
     eat(TokenType::VAR);
     return node;
   }
 
   std::shared_ptr<Node> var_stment() {
-    auto name = cur_token.value;
+    auto name = cur_token.sym;
+    auto loc = cur_token.loc;
     eat(TokenType::VAR);
 
     if (eat(TokenType::ASSIGN, true)) {
@@ -82,7 +92,7 @@ class Parser {
     }
 
     if (cur_token.type == TokenType::BRKET_OPEN) {
-      auto arr_access_node = std::make_shared<ArrAccessNode>(name);
+      auto arr_access_node = std::make_shared<ArrAccessNode>(name, loc);
       while (eat(TokenType::BRKET_OPEN, true)) {
         arr_access_node->dimensions.push_back(expr());
         eat(TokenType::BRKET_CLOSE);
@@ -96,31 +106,65 @@ class Parser {
     return std::make_shared<VarNode>(name);
   }
 
-  std::shared_ptr<Node> fn_decl(std::string &name, std::string &type) {
+  std::shared_ptr<Node> fn_decl(Symbol name, std::string &type) {
     eat(TokenType::PAREN_OPEN);
     auto fn_node = std::make_shared<FnDeclNode>(type, name);
     while (cur_token.type != TokenType::PAREN_CLOSE) {
       auto params_type = cur_token.value;
       eat(TokenType::VAR_TYPE);
-      auto params = cur_token.value;
+      auto params = cur_token.sym;
       eat(TokenType::VAR);
-      fn_node->params.push_back(std::make_shared<ParamsDeclNode>(std::make_shared<VarNode>(params), params_type));
+      auto param_node = std::make_shared<ParamsDeclNode>(std::make_shared<VarNode>(params), params_type);
+      // only the first extent may be left out
+      while (eat(TokenType::BRKET_OPEN, true)) {
+        if (cur_token.type != TokenType::BRKET_CLOSE) {
+          param_node->dimensions.push_back(expr());
+        } else if (param_node->dimensions.empty()) {
+          param_node->dimensions.push_back(nullptr);
+        } else {
+          throw std::runtime_error(get_err(ErrMsg::INV_TOKEN));
+        }
+        eat(TokenType::BRKET_CLOSE);
+      }
+      fn_node->params.push_back(param_node);
       if (cur_token.type == TokenType::PAREN_CLOSE) {
         break;
       }
       eat(TokenType::COMMA);
     }
     eat(TokenType::PAREN_CLOSE);
+    if (lazy != nullptr && open_blocks == 1) {
+      fn_node->lazy = skip_body();
+      return fn_node;
+    }
     eat(TokenType::BRACE_OPEN);
     fn_node->block = block();
     eat(TokenType::BRACE_CLOSE);
     return fn_node;
   }
+  // the range of a body between braces, matched by token
+  std::unique_ptr<LazyBody> skip_body() {
+    auto res = std::make_unique<LazyBody>(LazyBody{lazy, lexer.offset(), 0, cur_token.loc.line});
+    eat(TokenType::BRACE_OPEN);
+    for (std::size_t depth = 1;;) {
+      if (cur_token.type == TokenType::BRACE_OPEN) {
+        depth++;
+      } else if (cur_token.type == TokenType::BRACE_CLOSE && --depth == 0) {
+        break;
+      } else if (cur_token.type == TokenType::EOF_TOKEN) {
+        throw std::runtime_error(get_err(ErrMsg::INV_TOKEN));
+      }
+      eat(cur_token.type);
+    }
+    res->end = lexer.offset() - 1;
+    eat(TokenType::BRACE_CLOSE);
+    return res;
+  }
 
   void init_var_stment(std::vector<std::shared_ptr<Node>> &result, bool allow_func_decl, bool &should_eat_token) {
     auto var_type = cur_token.value;
     eat(TokenType::VAR_TYPE);
-    auto var_name = cur_token.value;
+    auto var_name = cur_token.sym;
     eat(TokenType::VAR);
 
     if (cur_token.type == TokenType::PAREN_OPEN) {
@@ -134,7 +178,7 @@ class Parser {
 
       while (cur_token.type == TokenType::COMMA) {
         eat(TokenType::COMMA);
-        auto cur_var_name = cur_token.value;
+        auto cur_var_name = cur_token.sym;
         eat(TokenType::VAR);
         result.push_back(var_decl(cur_var_name, var_type));
       }
@@ -300,90 +344,53 @@ class Parser {
   }
 
   std::shared_ptr<Node> expr() {
-    auto node = or_expr();
+    auto node = bin_expr(1);
 
     while (cur_token.type == TokenType::ASSIGN) {
       eat(TokenType::ASSIGN);
-      node = std::make_shared<AssignNode>(node, or_expr());
-    }
-
-    return node;
-  }
-  std::shared_ptr<Node> or_expr() {
-    auto node = and_expr();
-
-    while (cur_token.type == TokenType::OR) {
-      auto token_type = cur_token.type;
-      eat(token_type);
-      node = std::make_shared<BinNode>(node, and_expr(), token_type);
-    }
-
-    return node;
-  }
-  std::shared_ptr<Node> and_expr() {
-    auto node = bitwise();
-
-    while (cur_token.type == TokenType::AND) {
-      auto token_type = cur_token.type;
-      eat(token_type);
-      node = std::make_shared<BinNode>(node, bitwise(), token_type);
-    }
-
-    return node;
-  }
-  std::shared_ptr<Node> bitwise() {
-    auto node = cmp_eq();
-
-    while (cur_token.type == TokenType::BW_XOR) {
-      auto token_type = cur_token.type;
-      eat(token_type);
-      node = std::make_shared<BinNode>(node, cmp_eq(), token_type);
-    }
-
-    return node;
-  }
-  std::shared_ptr<Node> cmp_eq() {
-    auto node = cmp_neq();
-
-    while (cur_token.type == TokenType::CMP_EQU || cur_token.type == TokenType::CMP_NEQ) {
-      auto token_type = cur_token.type;
-      eat(token_type);
-      node = std::make_shared<BinNode>(node, cmp_neq(), token_type);
+      node = std::make_shared<AssignNode>(node, bin_expr(1));
     }
 
     return node;
   }
-  std::shared_ptr<Node> cmp_neq() {
-    auto node = add_sub_expr();
 
-    while (cur_token.type == TokenType::CMP_LTE || cur_token.type == TokenType::CMP_LES ||
-           cur_token.type == TokenType::CMP_GTE || cur_token.type == TokenType::CMP_GRT) {
-      auto token_type = cur_token.type;
-      eat(token_type);
-      node = std::make_shared<BinNode>(node, add_sub_expr(), token_type);
+  // binding power of left-associative binary operators, 0 for tokens that end an operand
+  static int get_prec(const TokenType &token_type) {
+    switch (token_type) {
+      case TokenType::OR:
+        return 1;
+      case TokenType::AND:
+        return 2;
+      case TokenType::BW_XOR:
+        return 3;
+      case TokenType::CMP_EQU:
+      case TokenType::CMP_NEQ:
+        return 4;
+      case TokenType::CMP_LTE:
+      case TokenType::CMP_LES:
+      case TokenType::CMP_GTE:
+      case TokenType::CMP_GRT:
+        return 5;
+      case TokenType::PLUS:
+      case TokenType::MINUS:
+        return 6;
+      case TokenType::MUL:
+      case TokenType::DIV:
+      case TokenType::MOD:
+        return 7;
+      default:
+        return 0;
     }
-
-    return node;
   }
 
-  std::shared_ptr<Node> add_sub_expr() {
-    auto node = mul_div_expr();
-
-    while (cur_token.type == TokenType::PLUS || cur_token.type == TokenType::MINUS) {
-      auto token_type = cur_token.type;
-      eat(token_type);
-      node = std::make_shared<BinNode>(node, mul_div_expr(), token_type);
-    }
-
-    return node;
-  }
-  std::shared_ptr<Node> mul_div_expr() {
+  // precedence climbing: parses operators binding at least as tightly as `min_prec`
+  std::shared_ptr<Node> bin_expr(int min_prec) {
     auto node = factor();
 
-    while (cur_token.type == TokenType::MUL || cur_token.type == TokenType::DIV || cur_token.type == TokenType::MOD) {
+    for (auto prec = get_prec(cur_token.type); prec != 0 && prec >= min_prec; prec = get_prec(cur_token.type)) {
       auto token_type = cur_token.type;
       eat(token_type);
-      node = std::make_shared<BinNode>(node, factor(), token_type);
+      node = std::make_shared<BinNode>(node, bin_expr(prec + 1), token_type);
     }
 
     return node;
@@ -426,7 +433,41 @@ class Parser {
   }
 
   public:
-  Parser(Lexer &_lexer) : lexer(_lexer), cur_token(lexer.get_next_token()) {}
+  Parser(Lexer &_lexer, std::shared_ptr<LazySource> _lazy = nullptr)
+      : lexer(_lexer), cur_token(lexer.get_next_token()), lazy(std::move(_lazy)) {}
   std::shared_ptr<ScopeNode> parse() { return scoped(); }
+  // whether parse() took every token; it stops quietly at the first one that cannot start a statement
+  bool at_end() const { return cur_token.type == TokenType::EOF_TOKEN; }
+
+  // byte ranges of the top-level declarations of `code`, found by brace depth without parsing: each ends at a `;`
+  // or a closing `}` at the top level
+  static std::vector<std::pair<std::size_t, std::size_t>> split(std::string_view code) {
+    std::vector<std::pair<std::size_t, std::size_t>> res;
+    std::size_t begin = std::string_view::npos;
+    int depth = 0;
+    for (std::size_t i = 0; i < code.size(); ++i) {
+      auto c = code[i];
+      if (std::isspace(static_cast<unsigned char>(c))) {
+        continue;
+      }
+      if (begin == std::string_view::npos) {
+        begin = i;
+      }
+      if (c == '\'') {
+        // like the Lexer, a char literal ends at the next quote
+        i = std::min(code.find('\'', i + 1), code.size() - 1);
+      } else if (c == '{') {
+        depth++;
+      } else if ((c == '}' && --depth <= 0) || (c == ';' && depth <= 0)) {
+        res.emplace_back(begin, i + 1);
+        begin = std::string_view::npos;
+        depth = 0;
+      }
+    }
+    if (begin != std::string_view::npos) {
+      res.emplace_back(begin, code.size());
+    }
+    return res;
+  }
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,235 @@
+#ifndef __POLICY_HPP
+#define __POLICY_HPP
+#include <algorithm>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "counters.hpp"
+#include "green.hpp"
+#include "node.hpp"
+#include "symbol.hpp"
+
+// Compile-time features of an Interpreter<Policy>. The interpreter calls a hook only when its flag is set, so the
+// flags off leave nothing behind on the hot paths. A policy derives from DefaultPolicy and overrides what it uses;
+// interpreters running loop chunks and forked operands get a policy of their own, which inherit() seeds from the
+// spawning one and join() merges back once they are done.
+struct DefaultPolicy {
+  // count operations and enforce Limits (see Governor)
+  static constexpr bool governed = false;
+  // check array indices that no loop guard covers (see BoundsAnalyzer)
+#ifdef BOUNDCHK
+  static constexpr bool bounds_checked = true;
+#else
+  static constexpr bool bounds_checked = false;
+#endif
+  static constexpr bool node_hooks = false, call_hooks = false, array_hooks = false, loop_hooks = false;
+
+  // every node evaluated as an rvalue
+  void on_node(const Node &) {}
+  // after the arguments are bound, and after the body has run
+  void on_call(const FnDeclNode &) {}
+  void on_return(const FnDeclNode &) {}
+  // every element read or written, by row-major offset
+  void on_array(const ArrAccessNode &, std::size_t) {}
+  // `n` iterations of a loop completed
+  void on_back_edge(const Node &, std::uint64_t) {}
+
+  void inherit(const DefaultPolicy &) {}
+  void join(const DefaultPolicy &) {}
+};
+
+struct GovernedPolicy : DefaultPolicy {
+  static constexpr bool governed = true;
+};
+
+// Counts, per function, the calls, nodes evaluated, array elements accessed and loop iterations, for --profile.
+// Code outside any function counts towards a null FnDeclNode. Names are kept, as the tree may be gone by print().
+class ProfilePolicy : public GovernedPolicy {
+  public:
+  struct Counts {
+    Symbol name = 0;
+    std::uint64_t calls = 0, nodes = 0, elements = 0, iterations = 0;
+  };
+  static constexpr bool node_hooks = true, call_hooks = true, array_hooks = true, loop_hooks = true;
+
+  protected:
+  std::unordered_map<const FnDeclNode *, Counts> counts{{nullptr, {}}};
+  std::vector<const FnDeclNode *> active;  // calls in progress, innermost last
+  Counts *cur = &counts[nullptr];
+
+  public:
+  ProfilePolicy() = default;
+  ProfilePolicy(const ProfilePolicy &) = delete;
+  ProfilePolicy &operator=(const ProfilePolicy &) = delete;
+
+  void on_node(const Node &) { cur->nodes++; }
+  void on_call(const FnDeclNode &fn) {
+    active.push_back(&fn);
+    cur = &counts[&fn];
+    cur->name = fn.name;
+    cur->calls++;
+  }
+  void on_return(const FnDeclNode &) {
+    active.pop_back();
+    cur = &counts[active.empty() ? nullptr : active.back()];
+  }
+  void on_array(const ArrAccessNode &, std::size_t) { cur->elements++; }
+  void on_back_edge(const Node &, std::uint64_t n) { cur->iterations += n; }
+
+  void inherit(const ProfilePolicy &from) {
+    active = from.active;
+    cur = &counts[active.empty() ? nullptr : active.back()];
+    cur->name = active.empty() ? 0 : active.back()->name;
+  }
+  void join(const ProfilePolicy &other) {
+    for (auto &[fn, c] : other.counts) {
+      auto &to = counts[fn];
+      to.name = c.name;
+      to.calls += c.calls;
+      to.nodes += c.nodes;
+      to.elements += c.elements;
+      to.iterations += c.iterations;
+    }
+  }
+
+  // one line per function that ran anything, busiest first, then by name
+  void print(std::ostream &os) const {
+    std::vector<std::pair<std::string, Counts>> rows;
+    for (auto &[fn, c] : counts) {
+      if (c.nodes != 0) {
+        rows.emplace_back(fn != nullptr ? sym_name(c.name) : "<global>", c);
+      }
+    }
+    std::sort(rows.begin(), rows.end(), [](const auto &a, const auto &b) {
+      return a.second.nodes != b.second.nodes ? a.second.nodes > b.second.nodes : a.first < b.first;
+    });
+    for (auto &[name, c] : rows) {
+      os << name << ": " << c.calls << " calls, " << c.nodes
+         << " nodes, " << c.elements << " array elements, " << c.iterations << " loop iterations\n";
+    }
+  }
+};
+// Charges the hardware counters of the thread running the program to the function on top of its call stack, for
+// --counters: what they moved between two calls or returns goes to the innermost function, so a function's counts
+// leave out those of its callees. Interpreters running loop chunks and forked operands on other threads count
+// nothing; the time the spawning thread spends waiting for them goes to the function that spawned them.
+class CounterPolicy : public GovernedPolicy {
+  public:
+  struct Counts {
+    Symbol name = 0;
+    std::uint64_t calls = 0;
+    PerfCounters::Values values{};
+  };
+  static constexpr bool call_hooks = true;
+
+  protected:
+  const PerfCounters *counters = nullptr;
+  std::unordered_map<const FnDeclNode *, Counts> counts{{nullptr, {}}};
+  std::vector<const FnDeclNode *> active;
+  Counts *cur = &counts[nullptr];
+  PerfCounters::Values last{};
+
+  void charge() {
+    if (counters != nullptr) {
+      auto now = counters->read();
+      PerfCounters::add(cur->values, now, last);
+      last = now;
+    }
+  }
+
+  public:
+  CounterPolicy() = default;
+  CounterPolicy(const CounterPolicy &) = delete;
+  CounterPolicy &operator=(const CounterPolicy &) = delete;
+
+  // counts from here on, on the calling thread
+  void start(const PerfCounters &_counters) {
+    counters = &_counters;
+    last = counters->read();
+  }
+  // charges what is left to the function on top
+  void stop() {
+    charge();
+    counters = nullptr;
+  }
+
+  void on_call(const FnDeclNode &fn) {
+    charge();
+    active.push_back(&fn);
+    cur = &counts[&fn];
+    cur->name = fn.name;
+    cur->calls++;
+  }
+  void on_return(const FnDeclNode &) {
+    charge();
+    active.pop_back();
+    cur = &counts[active.empty() ? nullptr : active.back()];
+  }
+
+  void inherit(const CounterPolicy &from) { active = from.active; }
+  void join(const CounterPolicy &other) {
+    for (auto &[fn, c] : other.counts) {
+      if (fn != nullptr) {
+        auto &to = counts[fn];
+        to.name = c.name;
+        to.calls += c.calls;
+      }
+    }
+  }
+
+  // one line per function that ran, busiest first by the first of `_counters` that opened, then by name
+  void print(std::ostream &os, const PerfCounters &_counters) const {
+    std::size_t key = 0;
+    while (key + 1 < PerfCounters::events && !_counters.has(key)) {
+      key++;
+    }
+    std::vector<std::pair<std::string, Counts>> rows;
+    for (auto &[fn, c] : counts) {
+      if (fn == nullptr || c.calls != 0) {
+        rows.emplace_back(fn != nullptr ? sym_name(c.name) : "<global>", c);
+      }
+    }
+    std::sort(rows.begin(), rows.end(), [key](const auto &a, const auto &b) {
+      auto x = a.second.values[key], y = b.second.values[key];
+      return x != y ? x > y : a.first < b.first;
+    });
+    for (auto &[name, c] : rows) {
+      os << name << ": " << c.calls << " calls";
+      _counters.print(os, c.values);
+      os << '\n';
+    }
+  }
+};
+// Lets the other jobs of a Scheduler run at loop back-edges and calls, for --green. The clock is only read every
+// `every` of them. Evaluating a node with the job's stack about to run out fails as too deep: nested expressions
+// recurse as calls do.
+class GreenPolicy : public GovernedPolicy {
+  public:
+  static constexpr bool node_hooks = true, call_hooks = true, loop_hooks = true;
+
+  protected:
+  static constexpr std::uint32_t every = 1 << 10;
+  std::uint32_t countdown = every;
+  std::uintptr_t stack_limit = Scheduler::stack_limit();  // of the job the interpreter was made in
+
+  void tick() {
+    if (--countdown == 0) {
+      countdown = every;
+      Scheduler::checkpoint();
+    }
+  }
+
+  public:
+  void on_node(const Node &) {
+    char probe;
+    if (reinterpret_cast<std::uintptr_t>(&probe) < stack_limit) {
+      throw ResourceExhausted(Resource::DEPTH);
+    }
+  }
+  void on_call(const FnDeclNode &) { tick(); }
+  void on_back_edge(const Node &, std::uint64_t) { tick(); }
+};
+#endif
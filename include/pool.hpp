@@ -0,0 +1,151 @@
+#ifndef __POOL_HPP
+#define __POOL_HPP
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool. Every worker owns a deque of tasks: it pushes and pops at the back, and takes from
+// the front of the other deques when its own is empty. A thread waiting for a batch runs queued tasks meanwhile,
+// so tasks can wait for tasks they spawned.
+class WorkPool {
+  protected:
+  typedef std::function<void()> Task;
+  struct Queue {
+    std::mutex m;
+    std::deque<Task> tasks;
+  };
+
+  // one deque per worker, the last one shared by threads outside the pool
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> threads;
+  std::atomic<std::size_t> queued = 0;
+  std::atomic<std::uint64_t> finished = 0;  // tasks run so far
+  std::mutex idle_m;
+  std::condition_variable idle;
+  bool stopping = false;  // guarded by idle_m
+
+  static inline thread_local const WorkPool *owner = nullptr;
+  static inline thread_local std::size_t self = 0;
+
+  std::size_t home() const { return owner == this ? self : queues.size() - 1; }
+
+  bool pop(Task &task) {
+    auto me = home();
+    for (std::size_t k = 0; k < queues.size(); ++k) {
+      auto &q = *queues[(me + k) % queues.size()];
+      std::lock_guard lk(q.m);
+      if (q.tasks.empty()) {
+        continue;
+      }
+      if (k == 0) {
+        task = std::move(q.tasks.back());
+        q.tasks.pop_back();
+      } else {
+        task = std::move(q.tasks.front());
+        q.tasks.pop_front();
+      }
+      queued--;
+      return true;
+    }
+    return false;
+  }
+
+  void work(std::size_t me) {
+    owner = this;
+    self = me;
+    Task task;
+    for (;;) {
+      if (pop(task)) {
+        task();
+        task = nullptr;
+        continue;
+      }
+      std::unique_lock lk(idle_m);
+      idle.wait(lk, [this] { return stopping || queued > 0; });
+      if (stopping) {
+        return;
+      }
+    }
+  }
+
+  public:
+  // `_workers` threads besides the ones that call run()
+  WorkPool(std::size_t _workers) {
+    for (std::size_t i = 0; i <= _workers; ++i) {
+      queues.push_back(std::make_unique<Queue>());
+    }
+    for (std::size_t i = 0; i < _workers; ++i) {
+      threads.emplace_back(&WorkPool::work, this, i);
+    }
+  }
+  WorkPool(const WorkPool &) = delete;
+  WorkPool &operator=(const WorkPool &) = delete;
+  ~WorkPool() {
+    {
+      std::lock_guard lk(idle_m);
+      stopping = true;
+    }
+    idle.notify_all();
+    for (auto &i : threads) {
+      i.join();
+    }
+  }
+
+  // threads that can work on a batch at once, including the caller
+  std::size_t size() const { return threads.size() + 1; }
+
+  // calls fn(0), ..., fn(n - 1), possibly in parallel, and returns once all have returned; fn must not throw.
+  // fn(0) runs on the calling thread.
+  template <typename F>
+  void run(std::size_t n, F &&fn) {
+    std::atomic<std::size_t> left = n;
+    {
+      auto &q = *queues[home()];
+      std::lock_guard lk(q.m);
+      for (auto k = n; k-- > 1;) {
+        q.tasks.push_back([this, &fn, &left, k] {
+          fn(k);
+          left--;
+          // `left` may be gone once it reaches 0, so waiters watch `finished`
+          finished++;
+          finished.notify_all();
+        });
+      }
+    }
+    queued += n - 1;
+    {
+      std::lock_guard lk(idle_m);
+    }
+    idle.notify_all();
+    fn(std::size_t(0));
+    left--;
+    Task task;
+    for (auto seen = finished.load(); left > 0; seen = finished.load()) {
+      if (pop(task)) {
+        task();
+        task = nullptr;
+      } else if (left > 0) {
+        // the rest of the batch is running elsewhere
+        finished.wait(seen);
+      }
+    }
+  }
+  // calls `here` on the calling thread while `there` may run on another one; neither must throw
+  template <typename F, typename G>
+  void fork(F &&here, G &&there) {
+    run(2, [&here, &there](std::size_t k) {
+      if (k == 0) {
+        here();
+      } else {
+        there();
+      }
+    });
+  }
+};
+#endif
@@ -0,0 +1,101 @@
+#ifndef __RECYCLER_HPP
+#define __RECYCLER_HPP
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+// Free lists of memory blocks by size class, powers of two from 16 bytes to max_block, so that the arrays and
+// bindings a call declares take blocks its predecessors freed rather than going to the general-purpose heap. A
+// freed block is linked through its own first bytes. Each thread has its own lists; a block may be freed on another
+// thread than the one it came from, as all of them come from operator new. Larger blocks, and blocks freed while
+// max_cached bytes are kept already, go back to the heap.
+class Recycler {
+  protected:
+  static constexpr std::size_t min_shift = 4;
+  static constexpr std::size_t classes = 17;
+  static constexpr std::size_t max_cached = std::size_t(64) << 20;
+
+  struct Free {
+    Free *next;
+  };
+  Free *heads[classes] = {};
+  std::size_t cached = 0;
+  std::uint64_t fresh = 0, reused = 0;
+
+  static std::size_t size_class(std::size_t _bytes) {
+    return _bytes <= (1 << min_shift) ? 0 : static_cast<std::size_t>(std::bit_width(_bytes - 1)) - min_shift;
+  }
+  static std::size_t block_size(std::size_t _class) { return std::size_t(1) << (_class + min_shift); }
+
+  Recycler() = default;
+
+  public:
+  static constexpr std::size_t max_block = std::size_t(1) << (classes - 1 + min_shift);
+
+  Recycler(const Recycler &) = delete;
+  Recycler &operator=(const Recycler &) = delete;
+  ~Recycler() {
+    for (auto head : heads) {
+      while (head != nullptr) {
+        ::operator delete(std::exchange(head, head->next));
+      }
+    }
+  }
+
+  static Recycler &local() {
+    thread_local Recycler res;
+    return res;
+  }
+
+  // at least `_bytes` bytes, aligned for any scalar type and not zeroed
+  void *get(std::size_t _bytes) {
+    if (_bytes > max_block) {
+      fresh++;
+      return ::operator new(_bytes);
+    }
+    auto c = size_class(_bytes);
+    if (auto block = heads[c]) {
+      heads[c] = block->next;
+      cached -= block_size(c);
+      reused++;
+      return block;
+    }
+    fresh++;
+    return ::operator new(block_size(c));
+  }
+  // a block get(_bytes) returned, on any thread
+  void put(void *_p, std::size_t _bytes) {
+    auto c = size_class(_bytes);
+    if (_bytes > max_block || cached + block_size(c) > max_cached) {
+      ::operator delete(_p);
+      return;
+    }
+    heads[c] = ::new (_p) Free{heads[c]};
+    cached += block_size(c);
+  }
+
+  // blocks taken from the heap and from the free lists so far on this thread
+  std::uint64_t heap_blocks() const { return fresh; }
+  std::uint64_t recycled_blocks() const { return reused; }
+};
+
+// allocator drawing from the Recycler of the calling thread, for containers of the call stack
+template <typename T>
+struct RecyclingAllocator {
+  typedef T value_type;
+
+  RecyclingAllocator() = default;
+  template <typename U>
+  RecyclingAllocator(const RecyclingAllocator<U> &) {}
+
+  T *allocate(std::size_t _n) { return static_cast<T *>(Recycler::local().get(_n * sizeof(T))); }
+  void deallocate(T *_p, std::size_t _n) { Recycler::local().put(_p, _n * sizeof(T)); }
+
+  template <typename U>
+  bool operator==(const RecyclingAllocator<U> &) const {
+    return true;
+  }
+};
+#endif
@@ -0,0 +1,34 @@
+#ifndef __SCOPES_HPP
+#define __SCOPES_HPP
+#include "walker.hpp"
+
+// Marks which blocks and for-loops introduce bindings. The interpreter only opens a scope for those; everything
+// else runs in the enclosing scope. Must run after any pass that adds declarations.
+class ScopeAnalyzer {
+  protected:
+  // declarations bind in the innermost scope, so plain nested blocks count, scoped constructs do not
+  static bool declares(const std::vector<std::shared_ptr<Node>> &stmts) {
+    for (auto &i : stmts) {
+      if (dynamic_cast<VarDeclNode *>(i.get()) || dynamic_cast<ArrDeclNode *>(i.get())) {
+        return true;
+      }
+      if (auto inner = dynamic_cast<BlockNode *>(i.get()); inner != nullptr && declares(inner->children)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  public:
+  void run(Node &root) {
+    walk(root, [](Node &node) {
+      if (auto block = dynamic_cast<BlockNode *>(&node)) {
+        block->binds = declares(block->children);
+      } else if (auto forl = dynamic_cast<ForLoopNode *>(&node)) {
+        forl->binds = declares(forl->init) || declares(forl->body->children);
+      }
+      return true;
+    });
+  }
+};
+#endif
@@ -0,0 +1,782 @@
+#ifndef __SSA_HPP
+#define __SSA_HPP
+#include <map>
+#include <tuple>
+
+#include "effects.hpp"
+
+typedef std::uint32_t ValueId;
+typedef std::uint32_t BindingId;
+
+// Kinds of SSA values. Arrays are values too: an array binding holds a memory state that every element store
+// replaces, and INDEX values select from a memory state, so equal loads share an id only while no store
+// intervenes.
+enum class ValueKind {
+  CONST,
+  ENTRY,   // value of a free name when the function is entered
+  PHI,     // merge of control flow: after an if, or at a loop header for the bindings the loop writes
+  OPAQUE,  // call results, input, fresh arrays, anything written behind our back
+  OP,
+  INDEX,
+};
+
+struct SSAValue {
+  ValueKind kind;
+  TokenType op = TokenType::OTHERS;
+  bool unary = false;
+  ValueId a = 0, b = 0;
+  int konst = 0;
+  unsigned level = 0;  // depth of the innermost loop the value varies in
+};
+
+struct SSABinding {
+  Symbol sym;
+  bool local;
+  unsigned level = 0;                       // loop depth of the declaration
+  std::shared_ptr<Node> *decl = nullptr;    // declaring statement; null for parameters and free names
+  bool used = false;                        // read, indexed, read by cin, or touched by a callee
+  std::vector<std::size_t> defs;            // assignments, excluding the declaration
+};
+
+// an assignment to a scalar binding
+struct SSADef {
+  BindingId binding;
+  std::shared_ptr<Node> *stmt;  // the assignment when it is a statement of its own, else null
+  bool used = false;            // some read, callee or φ may observe it
+};
+
+// one evaluation of a side-effect free expression
+struct SSAOccurrence {
+  std::shared_ptr<Node> *slot;
+  ValueId value;
+  int loop;            // innermost enclosing loop, -1 outside loops
+  int parent = -1;     // innermost enclosing occurrence
+  int dom;             // earlier occurrence of the same value that always runs before this one, or -1
+  unsigned size;       // AST nodes
+  unsigned reach;      // deepest loop level a binding the expression names is declared at
+  bool safe;           // cannot trap and reads no memory, so it may run speculatively
+};
+
+struct SSALoop {
+  Node *node;  // ForLoopNode or WhileLoopNode
+  int parent;
+  unsigned depth;
+  std::vector<std::shared_ptr<Node>> *stmts;  // statement list holding the loop
+  std::unordered_set<Symbol> writes;          // names assigned anywhere in the loop, callees included
+};
+
+// a read that copy propagation can replace
+struct SSACopy {
+  std::shared_ptr<Node> *slot;
+  std::shared_ptr<Node> with;
+  bool konst;
+};
+
+// SSA form of one function body, built straight from the structured AST: a single forward walk tracks the value
+// every binding holds, inserting φ-values where branches merge and at loop headers. Values are hash-consed, so
+// equal expressions over equal operands get one id (global value numbering). Names are resolved lexically;
+// bodies where that disagrees with the dynamic scoping at run time are `Effects::ambiguous` and not built.
+class SSAFunction {
+  protected:
+  struct State {
+    std::unordered_map<BindingId, ValueId> value;
+    std::unordered_map<BindingId, long> def;  // current SSADef, -1 after a merge or an unseen write
+    std::unordered_map<BindingId, BindingId> copy;  // binding last assigned from another one
+    bool returned = false;
+  };
+  struct ExprInfo {
+    ValueId value;
+    unsigned size = 1, reach = 0;
+    bool pure = true, safe = true;
+  };
+
+  const EffectsAnalyzer &effects;
+  std::map<std::tuple<ValueKind, TokenType, bool, ValueId, ValueId, int>, ValueId> table;
+  std::vector<ValueId> entry;  // per binding
+  std::vector<std::unordered_map<Symbol, BindingId>> scopes;
+  std::unordered_map<Symbol, BindingId> free;
+  // array parameters, and the arrays they may alias: other array parameters and free arrays
+  std::unordered_set<BindingId> refs, shared;
+  State state;
+  unsigned depth = 0;
+  int loop = -1;
+  // values computed on every path to the current point, by first occurrence; nested regions pop on exit
+  std::unordered_map<ValueId, int> avail;
+  std::vector<ValueId> avail_log;
+  std::vector<std::size_t> regions;
+
+  ValueId make(const SSAValue &_value) {
+    values.push_back(_value);
+    return static_cast<ValueId>(values.size() - 1);
+  }
+  ValueId fresh(ValueKind _kind) { return make({.kind = _kind, .level = depth}); }
+  ValueId intern(ValueKind _kind, TokenType _op, bool _unary, ValueId _a, ValueId _b, int _konst) {
+    auto [it, inserted] = table.try_emplace({_kind, _op, _unary, _a, _b, _konst}, 0);
+    if (inserted) {
+      auto level = _kind == ValueKind::CONST ? 0 : std::max(values[_a].level, _unary ? 0 : values[_b].level);
+      it->second = make({_kind, _op, _unary, _a, _b, _konst, level});
+    }
+    return it->second;
+  }
+  static bool commutes(TokenType _op) {
+    switch (_op) {
+      case TokenType::PLUS:
+      case TokenType::MUL:
+      case TokenType::CMP_EQU:
+      case TokenType::CMP_NEQ:
+      case TokenType::BW_XOR:
+      case TokenType::AND:
+      case TokenType::OR:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  BindingId add_binding(Symbol _sym, bool _local, ValueId _entry) {
+    SSABinding binding;
+    binding.sym = _sym;
+    binding.local = _local;
+    binding.level = depth;
+    bindings.push_back(binding);
+    entry.push_back(_entry);
+    return static_cast<BindingId>(bindings.size() - 1);
+  }
+  BindingId declare(Symbol _sym, std::shared_ptr<Node> *_decl) {
+    auto res = add_binding(_sym, true, fresh(ValueKind::OPAQUE));
+    bindings[res].decl = _decl;
+    scopes.back()[_sym] = res;
+    return res;
+  }
+  BindingId resolve(Symbol _sym) {
+    for (auto i = scopes.rbegin(); i != scopes.rend(); ++i) {
+      auto it = i->find(_sym);
+      if (it != i->end()) {
+        return it->second;
+      }
+    }
+    auto it = free.find(_sym);
+    if (it != free.end()) {
+      return it->second;
+    }
+    auto res = add_binding(_sym, false, make({.kind = ValueKind::ENTRY}));
+    bindings[res].level = 0;
+    free[_sym] = res;
+    return res;
+  }
+  ValueId current(BindingId _b) const {
+    auto it = state.value.find(_b);
+    return it == state.value.end() ? entry[_b] : it->second;
+  }
+  long current_def(const State &_state, BindingId _b) const {
+    auto it = _state.def.find(_b);
+    return it == _state.def.end() ? -1 : it->second;
+  }
+  // the current definition of `_b` may be observed
+  void keep_def(BindingId _b) {
+    auto def = current_def(state, _b);
+    if (def >= 0) {
+      defs[static_cast<std::size_t>(def)].used = true;
+    }
+  }
+  void define(BindingId _b, ValueId _value, std::shared_ptr<Node> *_stmt) {
+    defs.push_back({_b, _stmt});
+    bindings[_b].defs.push_back(defs.size() - 1);
+    state.value[_b] = _value;
+    state.def[_b] = static_cast<long>(defs.size() - 1);
+    state.copy.erase(_b);
+  }
+  void clobber(BindingId _b) {
+    state.value[_b] = fresh(ValueKind::OPAQUE);
+    state.def[_b] = -1;
+    state.copy.erase(_b);
+  }
+  // `_b` is indexed as an array
+  void array(BindingId _b) {
+    if (!refs.empty() && !bindings[_b].local) {
+      shared.insert(_b);
+    }
+  }
+  // an element of `_b` is written, and with it any array it may alias
+  void store(BindingId _b) {
+    state.value[_b] = fresh(ValueKind::OPAQUE);
+    if (shared.contains(_b)) {
+      for (auto i : shared) {
+        state.value[i] = fresh(ValueKind::OPAQUE);
+      }
+    }
+  }
+  void call_effects(const FnCallNode &call) {
+    if (call.fn == nullptr) {
+      return;
+    }
+    auto &eff = effects.of(call.fn);
+    auto read = [this](Symbol sym) {
+      auto b = resolve(sym);
+      bindings[b].used = true;
+      keep_def(b);
+    };
+    for (auto sym : eff.reads) {
+      read(sym);
+    }
+    // extents of array parameters
+    for (auto &param : call.fn->params) {
+      for (auto &dim : param->dimensions) {
+        if (dim != nullptr) {
+          walk(*dim, [&read](Node &n) {
+            if (auto var = dynamic_cast<VarNode *>(&n)) {
+              read(var->var_name);
+            } else if (auto acc = dynamic_cast<ArrAccessNode *>(&n)) {
+              read(acc->name);
+            }
+            return true;
+          });
+        }
+      }
+    }
+    for (auto sym : eff.writes) {
+      auto b = resolve(sym);
+      bindings[b].used = true;
+      clobber(b);
+    }
+    // a free array the callee writes may be one an array parameter refers to
+    for (auto i = refs.begin(); i != refs.end() && !eff.writes.empty(); ++i) {
+      state.value[*i] = fresh(ValueKind::OPAQUE);
+    }
+    effects.ref_writes(call, [this](Symbol sym) {
+      auto b = resolve(sym);
+      bindings[b].used = true;
+      array(b);
+      store(b);
+    });
+  }
+
+  // operands of a call bound to a builtin. Names and write targets are no expressions of their own, so that no
+  // pass rewrites them.
+  void builtin(FnCallNode &call) {
+    auto &roles = builtin_info(call.builtin).roles;
+    for (std::size_t i = 0; i < roles.size(); ++i) {
+      auto &arg = call.call_params[i];
+      Symbol sym;
+      std::shared_ptr<Node> *offset;
+      if (roles[i] == BuiltinInfo::VALUE) {
+        expr(arg);
+      } else if (auto var = dynamic_cast<VarNode *>(arg.get()); var != nullptr && roles[i] != BuiltinInfo::POINTER) {
+        auto b = resolve(var->var_name);
+        bindings[b].used = true;
+        keep_def(b);
+        if (roles[i] == BuiltinInfo::LVALUE) {
+          define(b, fresh(ValueKind::OPAQUE), nullptr);
+        }
+      } else if (auto acc = dynamic_cast<ArrAccessNode *>(arg.get())) {
+        for (auto &dim : acc->dimensions) {
+          expr(dim);
+        }
+        auto b = resolve(acc->name);
+        bindings[b].used = true;
+        array(b);
+        store(b);
+      } else if (pointer_operand(arg, sym, offset)) {
+        if (offset != nullptr) {
+          expr(*offset);
+        }
+        auto b = resolve(sym);
+        bindings[b].used = true;
+        array(b);
+        store(b);
+      }
+    }
+  }
+
+  void push_region() { regions.push_back(avail_log.size()); }
+  void pop_region() {
+    for (auto mark = regions.back(); avail_log.size() > mark; avail_log.pop_back()) {
+      avail.erase(avail_log.back());
+    }
+    regions.pop_back();
+  }
+  void occur(std::shared_ptr<Node> &slot, const ExprInfo &info, std::size_t first) {
+    auto idx = static_cast<int>(occurrences.size());
+    auto [it, inserted] = avail.try_emplace(info.value, idx);
+    if (inserted) {
+      avail_log.push_back(info.value);
+    }
+    occurrences.push_back({&slot, info.value, loop, -1, inserted ? -1 : it->second, info.size, info.reach,
+                           info.safe});
+    for (auto i = first; i < occurrences.size() - 1; ++i) {
+      if (occurrences[i].parent < 0) {
+        occurrences[i].parent = idx;
+      }
+    }
+  }
+
+  // names a loop may write, skipping those it declares itself
+  void scan_writes(Node &node, std::unordered_set<Symbol> &writes, std::unordered_set<Symbol> &decls) {
+    // arrays the loop indexes, and whether it writes one that others may alias
+    std::unordered_set<Symbol> arrays;
+    bool aliased = false;
+    auto may_alias = [&](Symbol sym) {
+      if (refs.empty() || decls.contains(sym)) {
+        return false;
+      }
+      auto b = resolve(sym);
+      return refs.contains(b) || !bindings[b].local;
+    };
+    auto target = [&](Node &n) {
+      if (auto var = dynamic_cast<VarNode *>(&n)) {
+        writes.insert(var->var_name);
+      } else if (auto acc = dynamic_cast<ArrAccessNode *>(&n)) {
+        writes.insert(acc->name);
+        aliased |= may_alias(acc->name);
+      }
+    };
+    walk(node, [&](Node &n) {
+      if (dynamic_cast<FnDeclNode *>(&n)) {
+        return false;
+      }
+      if (auto acc = dynamic_cast<ArrAccessNode *>(&n)) {
+        arrays.insert(acc->name);
+      }
+      if (auto assign = dynamic_cast<AssignNode *>(&n)) {
+        target(*assign->l);
+      } else if (auto io_in = dynamic_cast<IOInNode *>(&n)) {
+        for (auto &i : io_in->body) {
+          target(*i);
+        }
+      } else if (auto decl = dynamic_cast<VarDeclNode *>(&n)) {
+        decls.insert(decl->var->var_name);
+      } else if (auto arr_decl = dynamic_cast<ArrDeclNode *>(&n)) {
+        decls.insert(arr_decl->name);
+      } else if (auto bound = dynamic_cast<FnCallNode *>(&n); bound != nullptr && bound->builtin != Builtin::NONE) {
+        auto &roles = builtin_info(bound->builtin).roles;
+        for (std::size_t i = 0; i < roles.size(); ++i) {
+          Symbol sym;
+          std::shared_ptr<Node> *offset;
+          if (roles[i] == BuiltinInfo::LVALUE) {
+            target(*bound->call_params[i]);
+          } else if (roles[i] == BuiltinInfo::POINTER && pointer_operand(bound->call_params[i], sym, offset)) {
+            writes.insert(sym);
+            arrays.insert(sym);
+            aliased |= may_alias(sym);
+          }
+        }
+      } else if (auto call = dynamic_cast<FnCallNode *>(&n); call != nullptr && call->fn != nullptr) {
+        auto &eff = effects.of(call->fn);
+        writes.insert(eff.writes.begin(), eff.writes.end());
+        aliased |= !refs.empty() && !eff.writes.empty();
+        effects.ref_writes(*call, [&](Symbol sym) {
+          writes.insert(sym);
+          arrays.insert(sym);
+          aliased |= may_alias(sym);
+        });
+      }
+      return true;
+    });
+    // decls is complete only now
+    if (aliased) {
+      for (auto sym : arrays) {
+        if (may_alias(sym)) {
+          writes.insert(sym);
+        }
+      }
+      for (auto b : refs) {
+        writes.insert(bindings[b].sym);
+      }
+    }
+  }
+  // enters a loop: every binding it writes gets a φ at the header
+  std::vector<BindingId> enter_loop(Node &node, std::vector<std::shared_ptr<Node>> &list,
+                                    const std::unordered_set<Symbol> &writes,
+                                    const std::unordered_set<Symbol> &decls) {
+    loops.push_back({&node, loop, depth + 1, &list, writes});
+    loop = static_cast<int>(loops.size() - 1);
+    depth++;
+    std::vector<BindingId> res;
+    for (auto sym : writes) {
+      if (decls.contains(sym)) {
+        continue;
+      }
+      auto b = resolve(sym);
+      keep_def(b);
+      state.value[b] = fresh(ValueKind::PHI);
+      state.def[b] = -1;
+      state.copy.erase(b);
+      res.push_back(b);
+    }
+    push_region();
+    return res;
+  }
+  void leave_loop(const std::vector<BindingId> &carried, State &exit) {
+    if (!state.returned) {
+      for (auto b : carried) {
+        keep_def(b);
+      }
+    }
+    pop_region();
+    depth--;
+    loop = loops[static_cast<std::size_t>(loop)].parent;
+    state = std::move(exit);
+  }
+
+  // state after branches that may each have run
+  void merge(std::vector<State> &outs) {
+    std::vector<State *> live;
+    for (auto &i : outs) {
+      if (!i.returned) {
+        live.push_back(&i);
+      }
+    }
+    if (live.empty()) {
+      state = std::move(outs.back());
+      return;
+    }
+    auto res = *live[0];
+    std::unordered_set<BindingId> keys;
+    for (auto i : live) {
+      for (auto &[b, v] : i->value) {
+        keys.insert(b);
+      }
+      for (auto &[b, d] : i->def) {
+        keys.insert(b);
+      }
+    }
+    for (auto b : keys) {
+      bool same_value = true, same_def = true, same_copy = true;
+      auto value_of = [this, b](const State &s) {
+        auto it = s.value.find(b);
+        return it == s.value.end() ? entry[b] : it->second;
+      };
+      auto copy = live[0]->copy.find(b);
+      for (auto i : live) {
+        same_value &= value_of(*i) == value_of(*live[0]);
+        same_def &= current_def(*i, b) == current_def(*live[0], b);
+        auto other = i->copy.find(b);
+        same_copy &= (other == i->copy.end()) == (copy == live[0]->copy.end()) &&
+                     (other == i->copy.end() || other->second == copy->second);
+      }
+      if (!same_value) {
+        res.value[b] = fresh(ValueKind::PHI);
+      }
+      if (!same_def) {
+        for (auto i : live) {
+          if (auto def = current_def(*i, b); def >= 0) {
+            defs[static_cast<std::size_t>(def)].used = true;
+          }
+        }
+        res.def[b] = -1;
+      }
+      if (!same_copy) {
+        res.copy.erase(b);
+      }
+    }
+    state = std::move(res);
+  }
+
+  ExprInfo read(VarNode &var, std::shared_ptr<Node> &slot) {
+    auto b = resolve(var.var_name);
+    bindings[b].used = true;
+    keep_def(b);
+    auto value = current(b);
+    if (values[value].kind == ValueKind::CONST) {
+      copies.push_back({&slot, std::make_shared<NumNode>(std::to_string(values[value].konst)), true});
+    } else if (auto copy = state.copy.find(b); copy != state.copy.end()) {
+      auto src = copy->second;
+      if (current(src) == value && resolve(bindings[src].sym) == src) {
+        copies.push_back({&slot, std::make_shared<VarNode>(bindings[src].sym), false});
+      }
+    }
+    return {value, 1, bindings[b].level, true, true};
+  }
+  ExprInfo binary(BinNode &bin, std::shared_ptr<Node> &slot) {
+    auto first = occurrences.size();
+    auto l = expr(bin.l), r = expr(bin.r);
+    auto a = l.value, b = r.value;
+    if (commutes(bin.op) && b < a) {
+      std::swap(a, b);
+    }
+    ExprInfo res{intern(ValueKind::OP, bin.op, false, a, b, 0), l.size + r.size + 1, std::max(l.reach, r.reach),
+                 l.pure && r.pure, l.safe && r.safe};
+    if (bin.op == TokenType::DIV || bin.op == TokenType::MOD) {
+      auto divisor = dynamic_cast<NumNode *>(bin.r.get());
+      res.safe &= divisor != nullptr && divisor->value != 0 && divisor->value != -1;
+    }
+    if (res.pure) {
+      occur(slot, res, first);
+    }
+    return res;
+  }
+  ExprInfo unary(UnaryNode &un, std::shared_ptr<Node> &slot) {
+    auto first = occurrences.size();
+    auto sub = expr(un.expr);
+    ExprInfo res{intern(ValueKind::OP, un.op, true, sub.value, 0, 0), sub.size + 1, sub.reach, sub.pure, sub.safe};
+    if (res.pure) {
+      occur(slot, res, first);
+    }
+    return res;
+  }
+  ExprInfo load(ArrAccessNode &acc, std::shared_ptr<Node> &slot) {
+    auto first = occurrences.size();
+    std::vector<ExprInfo> idx;
+    for (auto &i : acc.dimensions) {
+      idx.push_back(expr(i));
+    }
+    auto b = resolve(acc.name);
+    bindings[b].used = true;
+    array(b);
+    ExprInfo res{current(b), 1, bindings[b].level, true, false};
+    for (auto &i : idx) {
+      res.value = intern(ValueKind::INDEX, TokenType::OTHERS, false, res.value, i.value, 0);
+      res.size += i.size;
+      res.reach = std::max(res.reach, i.reach);
+      res.pure &= i.pure;
+    }
+    if (res.pure) {
+      occur(slot, res, first);
+    }
+    return res;
+  }
+  // `_stmt` is the statement slot when the assignment is a statement of its own
+  ExprInfo assign(AssignNode &node, std::shared_ptr<Node> *_stmt) {
+    if (auto var = dynamic_cast<VarNode *>(node.l.get())) {
+      auto r = expr(node.r);
+      auto b = resolve(var->var_name);
+      define(b, r.value, _stmt);
+      if (auto src = dynamic_cast<VarNode *>(node.r.get())) {
+        if (auto src_b = resolve(src->var_name); src_b != b) {
+          state.copy[b] = src_b;
+        }
+      }
+      return {r.value, r.size + 2, r.reach, false, false};
+    }
+    if (auto acc = dynamic_cast<ArrAccessNode *>(node.l.get())) {
+      for (auto &i : acc->dimensions) {
+        expr(i);
+      }
+      auto r = expr(node.r);
+      auto b = resolve(acc->name);
+      bindings[b].used = true;
+      array(b);
+      store(b);
+      // the element type may narrow the value
+      return {fresh(ValueKind::OPAQUE), r.size + 2, r.reach, false, false};
+    }
+    return {fresh(ValueKind::OPAQUE), 1, 0, false, false};
+  }
+  ExprInfo expr(std::shared_ptr<Node> &slot) {
+    auto &node = *slot;
+    if (auto num = dynamic_cast<NumNode *>(&node)) {
+      return {intern(ValueKind::CONST, TokenType::OTHERS, false, 0, 0, num->value)};
+    }
+    if (auto var = dynamic_cast<VarNode *>(&node)) {
+      return read(*var, slot);
+    }
+    if (auto bin = dynamic_cast<BinNode *>(&node)) {
+      return binary(*bin, slot);
+    }
+    if (auto un = dynamic_cast<UnaryNode *>(&node)) {
+      return unary(*un, slot);
+    }
+    if (auto acc = dynamic_cast<ArrAccessNode *>(&node)) {
+      return load(*acc, slot);
+    }
+    if (auto as = dynamic_cast<AssignNode *>(&node)) {
+      return assign(*as, nullptr);
+    }
+    if (auto call = dynamic_cast<FnCallNode *>(&node); call != nullptr && call->builtin != Builtin::NONE) {
+      builtin(*call);
+    } else if (call != nullptr) {
+      for (auto &i : call->call_params) {
+        expr(i);
+      }
+      call_effects(*call);
+    } else if (auto io_out = dynamic_cast<IOOutNode *>(&node)) {
+      for (auto &i : io_out->body) {
+        if (!dynamic_cast<CharNode *>(i.get())) {
+          expr(i);
+        }
+      }
+    }
+    return {fresh(ValueKind::OPAQUE), 1, 0, false, false};
+  }
+
+  void input(IOInNode &io_in) {
+    for (auto &i : io_in.body) {
+      Node *target = i.get();
+      if (auto as = dynamic_cast<AssignNode *>(target)) {
+        assign(*as, nullptr);
+        target = as->l.get();
+      } else if (auto acc = dynamic_cast<ArrAccessNode *>(target)) {
+        for (auto &dim : acc->dimensions) {
+          expr(dim);
+        }
+      }
+      if (auto var = dynamic_cast<VarNode *>(target)) {
+        auto b = resolve(var->var_name);
+        bindings[b].used = true;
+        define(b, fresh(ValueKind::OPAQUE), nullptr);
+      } else if (auto acc = dynamic_cast<ArrAccessNode *>(target)) {
+        auto b = resolve(acc->name);
+        bindings[b].used = true;
+        array(b);
+        store(b);
+      }
+    }
+  }
+  void branch(BlockNode &block) {
+    push_region();
+    scopes.emplace_back();
+    stmts(block.children);
+    scopes.pop_back();
+    pop_region();
+  }
+  void if_stmt(IfNode &ifn) {
+    if (ifn.if_bl.first != nullptr) {
+      expr(ifn.if_bl.first);
+    }
+    auto chain = state;
+    std::vector<State> outs;
+    if (ifn.if_bl.second != nullptr) {
+      branch(*ifn.if_bl.second);
+    }
+    outs.push_back(std::move(state));
+    // later conditions only run when the earlier ones fail
+    push_region();
+    for (auto &elif : ifn.elif_bl) {
+      state = chain;
+      if (elif.first != nullptr) {
+        expr(elif.first);
+      }
+      chain = state;
+      if (elif.second != nullptr) {
+        branch(*elif.second);
+      }
+      outs.push_back(std::move(state));
+    }
+    state = std::move(chain);
+    if (ifn.else_bl != nullptr) {
+      branch(*ifn.else_bl);
+    }
+    outs.push_back(std::move(state));
+    pop_region();
+    merge(outs);
+  }
+  void for_stmt(ForLoopNode &forl, std::vector<std::shared_ptr<Node>> &list) {
+    scopes.emplace_back();
+    for (auto &i : forl.init) {
+      stmt(i);
+    }
+    std::unordered_set<Symbol> writes, decls;
+    if (forl.cond != nullptr) {
+      scan_writes(*forl.cond, writes, decls);
+    }
+    for (auto &i : forl.upd) {
+      scan_writes(*i, writes, decls);
+    }
+    scan_writes(*forl.body, writes, decls);
+    auto carried = enter_loop(forl, list, writes, decls);
+    if (forl.cond != nullptr) {
+      expr(forl.cond);
+    }
+    auto exit = state;
+    stmts(forl.body->children);
+    if (!state.returned) {
+      for (auto &i : forl.upd) {
+        expr(i);
+      }
+    }
+    leave_loop(carried, exit);
+    scopes.pop_back();
+  }
+  void while_stmt(WhileLoopNode &whilel, std::vector<std::shared_ptr<Node>> &list) {
+    std::unordered_set<Symbol> writes, decls;
+    scan_writes(*whilel.cond, writes, decls);
+    scan_writes(*whilel.body, writes, decls);
+    auto carried = enter_loop(whilel, list, writes, decls);
+    expr(whilel.cond);
+    auto exit = state;
+    scopes.emplace_back();
+    stmts(whilel.body->children);
+    scopes.pop_back();
+    leave_loop(carried, exit);
+  }
+
+  void stmt(std::shared_ptr<Node> &slot, std::vector<std::shared_ptr<Node>> *list = nullptr) {
+    auto &node = *slot;
+    if (dynamic_cast<FnDeclNode *>(&node)) {
+      return;
+    }
+    if (auto decl = dynamic_cast<VarDeclNode *>(&node)) {
+      auto init = expr(decl->var_value);
+      auto src = dynamic_cast<VarNode *>(decl->var_value.get());
+      auto src_b = src != nullptr ? resolve(src->var_name) : 0;
+      auto b = declare(decl->var->var_name, &slot);
+      defs.push_back({b, nullptr});
+      state.value[b] = init.value;
+      state.def[b] = static_cast<long>(defs.size() - 1);
+      if (src != nullptr) {
+        state.copy[b] = src_b;
+      }
+    } else if (auto arr_decl = dynamic_cast<ArrDeclNode *>(&node)) {
+      for (auto &i : arr_decl->dimensions) {
+        expr(i);
+      }
+      declare(arr_decl->name, &slot);
+    } else if (auto as = dynamic_cast<AssignNode *>(&node)) {
+      assign(*as, &slot);
+    } else if (auto io_in = dynamic_cast<IOInNode *>(&node)) {
+      input(*io_in);
+    } else if (auto ret = dynamic_cast<RetNode *>(&node)) {
+      expr(ret->expr);
+      state.returned = true;
+    } else if (auto scope = dynamic_cast<ScopeNode *>(&node)) {
+      branch(*scope->block);
+    } else if (auto block = dynamic_cast<BlockNode *>(&node)) {
+      stmts(block->children);
+    } else if (auto ifn = dynamic_cast<IfNode *>(&node)) {
+      if_stmt(*ifn);
+    } else if (auto forl = dynamic_cast<ForLoopNode *>(&node); forl != nullptr && list != nullptr) {
+      for_stmt(*forl, *list);
+    } else if (auto whilel = dynamic_cast<WhileLoopNode *>(&node); whilel != nullptr && list != nullptr) {
+      while_stmt(*whilel, *list);
+    } else if (expr(slot).pure) {
+      pure_stmts.push_back(&slot);
+    }
+  }
+  void stmts(std::vector<std::shared_ptr<Node>> &list) {
+    for (std::size_t i = 0; i < list.size(); ++i) {
+      if (state.returned) {
+        unreachable.emplace_back(&list, i);
+        return;
+      }
+      if (list[i] != nullptr) {
+        stmt(list[i], &list);
+      }
+    }
+  }
+
+  public:
+  std::vector<SSAValue> values;
+  std::vector<SSABinding> bindings;
+  std::vector<SSADef> defs;
+  std::vector<SSAOccurrence> occurrences;  // post-order: an occurrence comes after those nested in it
+  std::vector<SSALoop> loops;
+  std::vector<SSACopy> copies;
+  std::vector<std::shared_ptr<Node> *> pure_stmts;  // expression statements without side effects
+  std::vector<std::pair<std::vector<std::shared_ptr<Node>> *, std::size_t>> unreachable;  // list, first index
+
+  SSAFunction(const EffectsAnalyzer &_effects) : effects(_effects) {}
+
+  void build(BlockNode &body, const std::vector<std::shared_ptr<ParamsDeclNode>> &params) {
+    scopes.emplace_back();
+    for (auto &i : params) {
+      auto b = add_binding(i->var->var_name, true, make({.kind = ValueKind::ENTRY}));
+      scopes.back()[i->var->var_name] = b;
+      if (!i->dimensions.empty()) {
+        refs.insert(b);
+        shared.insert(b);
+      }
+    }
+    stmts(body.children);
+  }
+};
+#endif
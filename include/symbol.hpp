@@ -0,0 +1,35 @@
+#ifndef __SYMBOL_HPP
+#define __SYMBOL_HPP
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Identifiers are interned into dense ids by the lexer; everything after it compares and hashes ids only.
+typedef std::uint32_t Symbol;
+
+class SymbolTable {
+  protected:
+  std::unordered_map<std::string, Symbol> ids;
+  std::vector<std::string> names;
+
+  public:
+  static SymbolTable &global() {
+    static SymbolTable table;
+    return table;
+  }
+
+  Symbol intern(const std::string &_name) {
+    auto [it, inserted] = ids.try_emplace(_name, static_cast<Symbol>(names.size()));
+    if (inserted) {
+      names.push_back(_name);
+    }
+    return it->second;
+  }
+  const std::string &name(Symbol _sym) const { return names[_sym]; }
+  std::size_t size() const { return names.size(); }
+};
+
+inline Symbol intern(const std::string &_name) { return SymbolTable::global().intern(_name); }
+inline const std::string &sym_name(Symbol _sym) { return SymbolTable::global().name(_sym); }
+#endif
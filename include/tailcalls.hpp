@@ -0,0 +1,81 @@
+#ifndef __TAILCALLS_HPP
+#define __TAILCALLS_HPP
+#include <unordered_set>
+
+#include "effects.hpp"
+
+// Marks the returns of a function whose value is a call (see RetNode::tail), which the interpreter then makes once
+// the frame of the function is popped, so that self- and mutually tail-recursive functions run in constant stack
+// and memory. Names are looked up through the whole call stack, so a call is only marked when nothing its callee
+// reads or writes, itself or through its own calls, is a name the function declares, and when it passes no array
+// the function declares, whose storage goes with the frame.
+// Runs last in the Optimizer.
+class TailCallAnalyzer {
+  protected:
+  EffectsAnalyzer effects;
+  std::size_t marked = 0;
+
+  bool qualifies(const FnCallNode &call, const std::unordered_set<Symbol> &declared,
+                 const std::unordered_set<Symbol> &arrays) const {
+    if (call.fn == nullptr) {
+      return false;
+    }
+    auto &eff = effects.of(call.fn);
+    if (eff.unknown) {
+      return false;
+    }
+    for (auto names : {&eff.reads, &eff.writes}) {
+      for (auto name : *names) {
+        if (declared.contains(name)) {
+          return false;
+        }
+      }
+    }
+    for (std::size_t i = 0; i < call.call_params.size(); ++i) {
+      if (!call.fn->params[i]->dimensions.empty() &&
+          arrays.contains(static_cast<const VarNode &>(*call.call_params[i]).var_name)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void visit(FnDeclNode &fn) {
+    std::unordered_set<Symbol> declared, arrays;
+    for (auto &param : fn.params) {
+      declared.insert(param->var->var_name);
+    }
+    walk(*fn.block, [&](Node &n) {
+      if (auto decl = dynamic_cast<VarDeclNode *>(&n)) {
+        declared.insert(decl->var->var_name);
+      } else if (auto arr = dynamic_cast<ArrDeclNode *>(&n)) {
+        declared.insert(arr->name);
+        arrays.insert(arr->name);
+      }
+      return n.kind != NodeKind::FN_DECL;
+    });
+    walk(*fn.block, [&](Node &n) {
+      if (n.kind == NodeKind::RET) {
+        auto &ret = static_cast<RetNode &>(n);
+        ret.tail = ret.expr->kind == NodeKind::FN_CALL &&
+                   qualifies(static_cast<FnCallNode &>(*ret.expr), declared, arrays);
+        marked += ret.tail;
+      }
+      return n.kind != NodeKind::FN_DECL;
+    });
+  }
+
+  public:
+  void run(ScopeNode &root) {
+    effects.run(root);
+    walk(root, [this](Node &node) {
+      if (auto fn = dynamic_cast<FnDeclNode *>(&node)) {
+        visit(*fn);
+      }
+      return true;
+    });
+  }
+
+  std::size_t count() const { return marked; }
+};
+#endif
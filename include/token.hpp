@@ -1,7 +1,10 @@
 #ifndef __TOKEN_HPP
 #define __TOKEN_HPP
+#include <cstddef>
 #include <string>
 
+#include "symbol.hpp"
+
 // INTERNAL (LEXER-ONLY) VALUES ARE PREFIXED WITH __ AND HAS
 // A NEGATIVE INT ASSIGNED.
 enum class TokenType {
@@ -57,8 +60,14 @@ enum class TokenType {
   OTHERS = -1,
 };
 
+struct SourceLoc {
+  std::size_t line = 0, col = 0;
+};
+
 struct Token {
   TokenType type;
   std::string value;
+  SourceLoc loc{};
+  Symbol sym = 0;  // interned value of VAR tokens
 };
 #endif
\ No newline at end of file
@@ -1,9 +0,0 @@
-#ifndef __UTILS_HPP
-#define __UTILS_HPP
-template <class... Ts>
-struct overloaded : Ts... {
-  using Ts::operator()...;
-};
-template <class... Ts>
-overloaded(Ts...) -> overloaded<Ts...>;
-#endif
\ No newline at end of file
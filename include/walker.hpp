@@ -0,0 +1,106 @@
+#ifndef __WALKER_HPP
+#define __WALKER_HPP
+#include "node.hpp"
+
+// Calls `f` on every non-null child slot of `node`. Slots are passed by reference so passes can replace
+// subtrees in place; `f` must accept both `std::shared_ptr<Node> &` and `std::shared_ptr<BlockNode> &`.
+// Declared names (VarDeclNode::var, FnDeclNode::params) are not children.
+template <typename F>
+void for_each_child(Node &node, F &&f) {
+  auto each = [&f](auto &list) {
+    for (auto &i : list) {
+      if (i != nullptr) {
+        f(i);
+      }
+    }
+  };
+  auto one = [&f](auto &child) {
+    if (child != nullptr) {
+      f(child);
+    }
+  };
+  switch (node.kind) {
+    case NodeKind::BIN: {
+      auto &n = static_cast<BinNode &>(node);
+      one(n.l);
+      one(n.r);
+      break;
+    }
+    case NodeKind::UNARY:
+      one(static_cast<UnaryNode &>(node).expr);
+      break;
+    case NodeKind::ASSIGN: {
+      auto &n = static_cast<AssignNode &>(node);
+      one(n.l);
+      one(n.r);
+      break;
+    }
+    case NodeKind::VAR_DECL:
+      one(static_cast<VarDeclNode &>(node).var_value);
+      break;
+    case NodeKind::FN_DECL:
+      one(static_cast<FnDeclNode &>(node).block);
+      break;
+    case NodeKind::FN_CALL:
+      each(static_cast<FnCallNode &>(node).call_params);
+      break;
+    case NodeKind::ARR_DECL:
+      each(static_cast<ArrDeclNode &>(node).dimensions);
+      break;
+    case NodeKind::ARR_ACC:
+      each(static_cast<ArrAccessNode &>(node).dimensions);
+      break;
+    case NodeKind::BLOCK:
+      each(static_cast<BlockNode &>(node).children);
+      break;
+    case NodeKind::SCOPE:
+      one(static_cast<ScopeNode &>(node).block);
+      break;
+    case NodeKind::FOR: {
+      auto &n = static_cast<ForLoopNode &>(node);
+      each(n.init);
+      one(n.cond);
+      each(n.upd);
+      one(n.body);
+      break;
+    }
+    case NodeKind::WHILE: {
+      auto &n = static_cast<WhileLoopNode &>(node);
+      one(n.cond);
+      one(n.body);
+      break;
+    }
+    case NodeKind::IF: {
+      auto &n = static_cast<IfNode &>(node);
+      one(n.if_bl.first);
+      one(n.if_bl.second);
+      for (auto &elif : n.elif_bl) {
+        one(elif.first);
+        one(elif.second);
+      }
+      one(n.else_bl);
+      break;
+    }
+    case NodeKind::RET:
+      one(static_cast<RetNode &>(node).expr);
+      break;
+    case NodeKind::IO_OUT:
+      each(static_cast<IOOutNode &>(node).body);
+      break;
+    case NodeKind::IO_IN:
+      each(static_cast<IOInNode &>(node).body);
+      break;
+    default:
+      break;
+  }
+}
+
+// Pre-order walk. `f(Node &)` returns whether to descend into the node's children.
+template <typename F>
+void walk(Node &node, F &&f) {
+  if (!f(node)) {
+    return;
+  }
+  for_each_child(node, [&f](auto &child) { walk(*child, f); });
+}
+#endif
@@ -1,44 +1,272 @@
+// std::sort's heap fallback in libstdc++ trips a false -Wstrict-overflow at -O3; GCC reports the out-of-line copies
+// where the header is read and the inlined ones at the caller, so both here and CallStack::Array::sort ignore it
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wstrict-overflow"
+#include <algorithm>
 #include <chrono>
+#include <exception>
+#include <filesystem>
 #include <fstream>
+#include <functional>
+#include <sstream>
+#pragma GCC diagnostic pop
 
+#include "bounds.hpp"
+#include "green.hpp"
+#include "counters.hpp"
+#include "incremental.hpp"
 #include "interpreter.hpp"
+#include "lazy.hpp"
 #include "lexer.hpp"
+#include "linker.hpp"
+#include "optimizer.hpp"
+#include "options.hpp"
+#include "parallel_parser.hpp"
 #include "parser.hpp"
+#include "scopes.hpp"
 
 using std::chrono::duration_cast;
 using std::chrono::microseconds;
 
-const char *get_source(int argc, char **argv) {
-  if (argc < 2) {
-    return "source-code.cpp";
-  }
-  return argv[1];
+void print_stats(const ExecStats &stats) {
+  std::cerr << "Operations: " << stats.ops << ", elapsed: " << stats.elapsed.count()
+            << " ms, memory: " << stats.memory << " bytes (peak " << stats.peak_memory
+            << " bytes), call depth: " << stats.depth << ", blocks: " << stats.heap_blocks << " from the heap, "
+            << stats.recycled_blocks << " recycled\n";
 }
 
-int main(int argc, char **argv) {
-  auto st_time = std::chrono::high_resolution_clock::now();
-  std::ifstream file(get_source(argc, argv));
+typedef std::chrono::high_resolution_clock::time_point TimePoint;
+// builds the program to run, parsing on the pool if there is one and counting its phases
+typedef std::function<std::shared_ptr<ScopeNode>(WorkPool *, PhaseCounters &)> Loader;
 
-  std::string code, temp;
+// ignore #include stuff and `using namespace std;`
+const int skipped_lines = 3;
 
-  // ignore #include stuff and `using namespace std;`
-  for (int i = 0; i < 3; ++i) {
+std::string read_source(const std::string &path) {
+  std::ifstream file(path);
+  std::string code, temp;
+  for (int i = 0; i < skipped_lines; ++i) {
     std::getline(file, temp);
   }
   while (std::getline(file, temp)) {
     code += temp + '\n';
   }
   code += "main();";
+  return code;
+}
 
-  Lexer lexer(code);
-  Parser parser(lexer);
-  Interpreter interpreter;
+// lexes, parses and analyzes `code` as the options ask, counting each phase; takes `code` like Lexer does
+std::shared_ptr<ScopeNode> build(const Options &opts, std::string &code, WorkPool *pool, PhaseCounters &phases) {
+  // the parser lexes as it goes: the lexer is counted on a run of its own, which the parse phase then repeats
+  if (phases.enabled()) {
+    auto copy = code;
+    phases.measure("lex", [&] {
+      SymbolTable symbols;
+      Lexer lexer(copy, skipped_lines + 1, symbols);
+      while (lexer.get_next_token().type != TokenType::EOF_TOKEN) {
+      }
+    });
+  }
+  std::shared_ptr<ScopeNode> program;
+  phases.measure("parse", [&] {
+    program = opts.lazy ? std::make_shared<LazySource>(std::move(code))->parse(skipped_lines + 1)
+                        : ParallelParser(pool).parse(code, skipped_lines + 1);
+  });
+  phases.measure("optimize", [&] {
+    Linker().run(*program);
+    // the passes look into every body
+    if (!opts.lazy) {
+      Optimizer optimizer(opts.opt);
+      optimizer.run(*program);
+      if (opts.opt.report) {
+        optimizer.report().print(std::cerr, opts.opt);
+      }
+    }
+#ifdef BOUNDCHK
+    BoundsAnalyzer().run(*program);
+#endif
+    ScopeAnalyzer().run(*program);
+  });
+  return program;
+}
 
-  parser.parse()->accept(interpreter);
+// runs the program `load` returns on an Interpreter<Policy>; returns the exit status
+template <typename Policy>
+int run(const Options &opts, const Loader &load, TimePoint st_time) {
+  Interpreter<Policy> interpreter(opts.limits);
+  interpreter.set_array_options(opts.arrays);
+  auto threads = opts.threads != 0 ? opts.threads : std::max(1u, std::thread::hardware_concurrency());
+  std::unique_ptr<WorkPool> pool;
+  if (threads > 1) {
+    pool = std::make_unique<WorkPool>(threads - 1);
+    if (opts.opt.parallel) {
+      interpreter.set_pool(pool.get());
+    }
+  }
 
-  file.close();
+  std::unique_ptr<PerfCounters> counters;
+  if constexpr (std::is_same_v<Policy, CounterPolicy>) {
+    counters = std::make_unique<PerfCounters>();
+    counters->print_missing(std::cerr);
+  }
+  PhaseCounters phases(counters.get());
+
+  try {
+    auto program = load(pool.get(), phases);
+    interpreter.count_blocks();
+    phases.measure("execute", [&] {
+      if constexpr (std::is_same_v<Policy, CounterPolicy>) {
+        interpreter.policy().start(*counters);
+        interpreter.vi_stmt(*program);
+        interpreter.policy().stop();
+      } else {
+        interpreter.vi_stmt(*program);
+      }
+    });
+  } catch (const ResourceExhausted &e) {
+    std::cout.flush();
+    std::cerr << e.what() << '\n';
+    print_stats(interpreter.stats());
+    return get_exit_status(e.resource);
+  } catch (const std::bad_alloc &) {
+    std::cout.flush();
+    std::cerr << ResourceExhausted(Resource::MEMORY).what() << '\n';
+    print_stats(interpreter.stats());
+    return get_exit_status(Resource::MEMORY);
+  } catch (const std::exception &e) {
+    std::cout.flush();
+    std::cerr << e.what() << '\n';
+    return 1;
+  }
 
   auto ed_time = std::chrono::high_resolution_clock::now();
   std::cerr << "Time elapsed: " << duration_cast<microseconds>(ed_time - st_time).count() << " microseconds\n";
+  if (opts.stats) {
+    print_stats(interpreter.stats());
+  }
+  if constexpr (std::is_same_v<Policy, ProfilePolicy>) {
+    interpreter.policy().print(std::cerr);
+  }
+  if constexpr (std::is_same_v<Policy, CounterPolicy>) {
+    if (phases.enabled()) {
+      phases.print(std::cerr);
+      interpreter.policy().print(std::cerr, *counters);
+    }
+  }
   return 0;
-}
\ No newline at end of file
+}
+
+// operations are only counted for limits and statistics
+int run(const Options &opts, const Loader &load, TimePoint st_time) {
+  auto &lim = opts.limits;
+  if (opts.counters) {
+    return run<CounterPolicy>(opts, load, st_time);
+  }
+  if (opts.profile) {
+    return run<ProfilePolicy>(opts, load, st_time);
+  }
+  if (lim.max_ops != 0 || lim.time_limit.count() != 0 || lim.max_memory != 0 || lim.max_depth != 0 || opts.stats) {
+    return run<GovernedPolicy>(opts, load, st_time);
+  }
+  return run<DefaultPolicy>(opts, load, st_time);
+}
+
+// reruns the source whenever it is saved, reparsing only the declarations that changed
+[[noreturn]] void watch(const Options &opts) {
+  IncrementalParser parser;
+  std::filesystem::file_time_type seen;
+  for (;;) {
+    std::error_code ec;
+    auto mtime = std::filesystem::last_write_time(opts.source, ec);
+    if (ec || mtime == seen) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      continue;
+    }
+    seen = mtime;
+    auto st_time = std::chrono::high_resolution_clock::now();
+    auto code = read_source(opts.source);
+    run(opts, [&](WorkPool *, PhaseCounters &phases) {
+      std::shared_ptr<ScopeNode> res;
+      phases.measure("parse", [&] { res = parser.update(code, skipped_lines + 1); });
+      std::cerr << "Parsed " << parser.parsed_count() << " declarations, kept " << parser.reused_count() << '\n';
+      return res;
+    }, st_time);
+    std::cerr << "Watching " << opts.source << '\n';
+  }
+}
+
+// runs every source on a stack of its own on this thread, taking turns by time slice (see Scheduler); each reads the
+// `.in` file next to it, if any, and its output is printed as soon as it is done. Returns the status of the first
+// source to fail.
+int run_green(const Options &opts) {
+  int status = 0;
+  // the scheduler counts the time of each job over its own turns
+  auto limits = opts.limits;
+  limits.time_limit = std::chrono::milliseconds(0);
+  // the passes before the run recurse as deep as a source nests, with no check against the stack of a job: every
+  // source is built in full here, on the stack of this thread
+  auto eager = opts;
+  eager.lazy = false;
+  Scheduler scheduler(opts.green_stack, std::chrono::microseconds(opts.slice), opts.limits.time_limit);
+  for (auto &source : opts.sources) {
+    std::shared_ptr<ScopeNode> program;
+    std::exception_ptr failed;
+    try {
+      auto code = read_source(source);
+      PhaseCounters phases;
+      program = build(eager, code, nullptr, phases);
+    } catch (...) {
+      failed = std::current_exception();
+    }
+    scheduler.add([&, program, failed] {
+      std::ostringstream out;
+      std::string error;
+      int res = 0;
+      try {
+        if (failed) {
+          std::rethrow_exception(failed);
+        }
+        std::ifstream in(source.substr(0, source.rfind(".cpp")) + ".in");
+        Interpreter<GreenPolicy> interpreter(limits);
+        interpreter.set_array_options(opts.arrays);
+        interpreter.set_streams(in, out);
+        interpreter.vi_stmt(*program);
+      } catch (const ResourceExhausted &e) {
+        error = e.what();
+        res = get_exit_status(e.resource);
+      } catch (const std::bad_alloc &) {
+        error = ResourceExhausted(Resource::MEMORY).what();
+        res = get_exit_status(Resource::MEMORY);
+      } catch (const std::exception &e) {
+        error = e.what();
+        res = 1;
+      }
+      std::cout << "==> " << source << " <==\n" << out.str() << std::flush;
+      if (res != 0) {
+        std::cerr << source << ": " << error << '\n';
+        status = status != 0 ? status : res;
+      }
+    });
+  }
+  scheduler.run();
+  return status;
+}
+
+int main(int argc, char **argv) {
+  auto st_time = std::chrono::high_resolution_clock::now();
+  Options opts;
+  try {
+    opts = parse_options(argc, argv);
+  } catch (const std::invalid_argument &e) {
+    std::cerr << e.what() << '\n';
+    return 2;
+  }
+  if (opts.watch) {
+    watch(opts);
+  }
+  if (opts.green) {
+    return run_green(opts);
+  }
+  auto code = read_source(opts.source);
+  return run(opts, [&](WorkPool *pool, PhaseCounters &phases) { return build(opts, code, pool, phases); }, st_time);
+}
@@ -0,0 +1,25 @@
+#include <cstdio>
+#include <iostream>
+using namespace std;
+int main() {
+  int n;
+  cin >> n;
+  int a = n;
+  int b = a;
+  int s = 0;
+  for (int i = 0; i < n; i = i + 1) {
+    s = s + b;
+    b = s % 7;
+    s = s + b * 2;
+    a = b;
+    b = a + i;
+  }
+  int c = 5;
+  int k = 0;
+  while (k < 4) {
+    s = s + c;
+    c = k;
+    k = k + 1;
+  }
+  cout << s << ' ' << a << ' ' << b << ' ' << c << endl;
+}
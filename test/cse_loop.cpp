@@ -0,0 +1,17 @@
+#include <cstdio>
+#include <iostream>
+using namespace std;
+int main() {
+  int x, y;
+  cin >> x >> y;
+  int s = 0;
+  for (int i = 0; i < 6; i = i + 1) {
+    int p = x * y + 3;
+    s = s + p + (x * y + 3) % 5;
+    x = x + 1;
+    s = s + (x * y + 3) % 7;
+    y = s % 11;
+    s = s + x * y;
+  }
+  cout << s << ' ' << x << ' ' << y << endl;
+}
@@ -0,0 +1,18 @@
+#include <cstdio>
+#include <iostream>
+using namespace std;
+int main() {
+  int n;
+  cin >> n;
+  int s = 0;
+  int last = 0;
+  int t = 0;
+  for (int i = 0; i < n; i = i + 1) {
+    t = s * 2;
+    t = s + last;
+    s = t % 1000;
+    last = i;
+    int unused = s * 3;
+  }
+  cout << s << ' ' << last << endl;
+}
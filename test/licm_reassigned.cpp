@@ -0,0 +1,14 @@
+#include <cstdio>
+#include <iostream>
+using namespace std;
+int g = 0;
+int main() {
+  int x;
+  cin >> x;
+  int v = 78;
+  for (int i = 0; i < 5; i = i + 1) {
+    v = x * 3;
+    g = v % 1000;
+  }
+  cout << g << endl;
+}
@@ -0,0 +1,31 @@
+#!/bin/sh
+# usage: compare.sh BASELINE CANDIDATE PROGRAM.cpp...
+# Runs each program on its .in file three times with both interpreters and prints the best times and the speedup.
+set -e
+base=$1
+cand=$2
+shift 2
+
+# best "Time elapsed" of three runs, in microseconds
+best() {
+  res=
+  for r in 1 2 3; do
+    t=$($1 "$2" < "${2%.cpp}.in" 2>&1 >/dev/null | awk '/Time elapsed/ { print $3 }')
+    if [ -z "$res" ] || [ "$t" -lt "$res" ]; then
+      res=$t
+    fi
+  done
+  echo "$res"
+}
+
+total_base=0
+total_cand=0
+for p in "$@"; do
+  b=$(best "$base" "$p")
+  c=$(best "$cand" "$p")
+  total_base=$((total_base + b))
+  total_cand=$((total_cand + c))
+  awk -v p="$p" -v b="$b" -v c="$c" 'BEGIN { printf "%-20s %8.1f ms %8.1f ms  %.2fx\n", p, b / 1000, c / 1000, b / c }'
+done
+awk -v b="$total_base" -v c="$total_cand" \
+  'BEGIN { printf "%-20s %8.1f ms %8.1f ms  %.2fx\n", "total", b / 1000, c / 1000, b / c }'
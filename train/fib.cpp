@@ -0,0 +1,26 @@
+#include <cstdio>
+#include <iostream>
+using namespace std;
+int fib(int k) {
+  if (k < 2) {
+    return k;
+  }
+  return fib(k - 1) + fib(k - 2);
+}
+int gcd(int a, int b) {
+  if (b == 0) {
+    return a;
+  }
+  return gcd(b, a % b);
+}
+int main() {
+  int n, m;
+  cin >> n >> m;
+  int s = 0;
+  for (int i = 1; i <= m; i = i + 1) {
+    for (int j = 1; j <= m; j = j + 1) {
+      s = s + gcd(i, j);
+    }
+  }
+  cout << fib(n) << ' ' << s << endl;
+}
@@ -0,0 +1,33 @@
+#include <cstdio>
+#include <iostream>
+using namespace std;
+int seed;
+int next(int mod) {
+  seed = (seed * 1103 + 12345) % 1000003;
+  return seed % mod;
+}
+int main() {
+  int n, m;
+  cin >> n >> m >> seed;
+  char a[n];
+  char b[m];
+  for (int i = 0; i < n; i = i + 1) {
+    a[i] = 97 + next(4);
+  }
+  for (int j = 0; j < m; j = j + 1) {
+    b[j] = 97 + next(4);
+  }
+  int dp[n + 1][m + 1];
+  for (int i = 1; i <= n; i = i + 1) {
+    for (int j = 1; j <= m; j = j + 1) {
+      if (a[i - 1] == b[j - 1]) {
+        dp[i][j] = dp[i - 1][j - 1] + 1;
+      } else if (dp[i - 1][j] > dp[i][j - 1]) {
+        dp[i][j] = dp[i - 1][j];
+      } else {
+        dp[i][j] = dp[i][j - 1];
+      }
+    }
+  }
+  cout << dp[n][m] << endl;
+}
@@ -0,0 +1,22 @@
+#include <cstdio>
+#include <iostream>
+using namespace std;
+bool composite[4000001];
+int main() {
+  int n;
+  cin >> n;
+  int primes = 0, twins = 0, last = 0;
+  for (int i = 2; i <= n; i = i + 1) {
+    if (!composite[i]) {
+      primes = primes + 1;
+      if (i - last == 2) {
+        twins = twins + 1;
+      }
+      last = i;
+      for (int j = i * i; j <= n && i <= 46340; j = j + i) {
+        composite[j] = true;
+      }
+    }
+  }
+  cout << primes << ' ' << twins << endl;
+}
@@ -0,0 +1,46 @@
+#include <cstdio>
+#include <iostream>
+using namespace std;
+int partition(int v[], int lo, int hi) {
+  int pivot = v[(lo + hi) / 2];
+  int i = lo, j = hi;
+  while (i <= j) {
+    while (v[i] < pivot) {
+      i = i + 1;
+    }
+    while (v[j] > pivot) {
+      j = j - 1;
+    }
+    if (i <= j) {
+      int t = v[i];
+      v[i] = v[j];
+      v[j] = t;
+      i = i + 1;
+      j = j - 1;
+    }
+  }
+  return i;
+}
+int quicksort(int v[], int lo, int hi) {
+  if (lo >= hi) {
+    return 0;
+  }
+  int mid = partition(v, lo, hi);
+  quicksort(v, lo, mid - 1);
+  quicksort(v, mid, hi);
+  return 0;
+}
+int main() {
+  int n;
+  cin >> n;
+  int v[n];
+  for (int i = 0; i < n; i = i + 1) {
+    cin >> v[i];
+  }
+  quicksort(v, 0, n - 1);
+  int sorted = 1;
+  for (int i = 1; i < n; i = i + 1) {
+    sorted = sorted && v[i - 1] <= v[i];
+  }
+  cout << sorted << ' ' << v[0] << ' ' << v[n / 2] << ' ' << v[n - 1] << endl;
+}
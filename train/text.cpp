@@ -0,0 +1,48 @@
+#include <cstdio>
+#include <iostream>
+using namespace std;
+char line[100000];
+int counts[128];
+int seed;
+int next(int mod) {
+  seed = (seed * 1103 + 12345) % 1000003;
+  return seed % mod;
+}
+int main() {
+  int n;
+  cin >> n >> seed;
+  for (int i = 0; i < n; i = i + 1) {
+    line[i] = 97 + next(5);
+  }
+  int vowels = 0, runs = 1, pal = 0;
+  for (int i = 0; i < n; i = i + 1) {
+    counts[line[i]] = counts[line[i]] + 1;
+    if (line[i] == 97 || line[i] == 101) {
+      vowels = vowels + 1;
+    } else if (i > 0) {
+      runs = runs + (line[i] != line[i - 1]);
+    }
+  }
+  for (int c = 1; c < n - 1; c = c + 1) {
+    int r = 1, same = 1;
+    while (same) {
+      same = 0;
+      if (c - r >= 0) {
+        if (c + r < n) {
+          same = line[c - r] == line[c + r];
+        }
+      }
+      r = r + same;
+    }
+    if (r > pal) {
+      pal = r;
+    }
+  }
+  int most = 97;
+  for (int c = 97; c <= 122; c = c + 1) {
+    if (counts[c] > counts[most]) {
+      most = c;
+    }
+  }
+  cout << counts[most] << ' ' << runs << ' ' << vowels << ' ' << 2 * pal - 1 << endl;
+}